@@ -1,7 +1,21 @@
-#include "..\guid.h"
+#include "../guid.h"
+#include "../guid_map.h"
+#include "../guid_algorithm.h"
+#include "../guid_column.h"
+#include "../guid_pool.h"
 
 #include <cassert>
 #include <string>
+#include <vector>
+#include <cstdio>
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+
+#if !defined(_WIN32)
+#include <unistd.h>
+#include <sys/wait.h>
+#endif
 
 int main()
 {
@@ -19,6 +33,59 @@ int main()
     g.to_string('b'); // {xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx} - lowercase with brackets
     g.to_string('B'); // {XXXXXXXX-XXXX-XXXX-XXXX-XXXXXXXXXXXX} - uppercase with brackets
 
+    // format into and parse from a caller provided buffer without allocating
+    char buffer[guid::max_string_length];
+    char* end = g.to_chars(buffer, guid_format::lowercase_no_brackets);
+    guid parsed;
+    bool ok = parsed.from_chars(buffer, end - buffer);
+
+    // create a time ordered guid, guids created on the same thread sort in creation order
+    guid ordered = guid::create_new(guid_version::v7);
+    guid_version version = ordered.version();
+
+    // guids can be used as keys in std::unordered_map, or in the flat guid_map and guid_set
+    guid_map<std::string> names;
+    names[g] = "first";
+    guid_set seen;
+    seen.insert(g);
+
+    // parse a column of guids, one per line, malformed rows are reported by offset
+    std::vector<guid> column;
+    std::vector<guid_parse_error> errors;
+    bool all_valid = parse_guids("2AC3E955-939F-4756-8BC1-940BB7C882C3\n{2AC3E955-939F-4756-8BC1-940BB7C882C3}\n", column, errors);
+
+    // guid literals are parsed at compile time, a malformed literal does not compile
+    constexpr guid known = "6ba7b810-9dad-11d1-80b4-00c04fd430c8"_guid;
+    static_assert(!known.empty(), "");
+
+    // guids are ordered like their canonical strings, large arrays can be sorted, deduplicated and searched in bulk
+    bool before = g < ordered;
+    std::vector<guid> sorted = column;
+    sort_guids(sorted.data(), sorted.data() + sorted.size());
+    sorted.resize(unique_guids(sorted.data(), sorted.data() + sorted.size()) - sorted.data());
+    bool found = contains_sorted_guids(sorted.data(), sorted.data() + sorted.size(), g);
+
+    // name based guids, the same namespace and name always give the same guid
+    guid from_name = guid::create_from_name(guid_namespace_dns, "www.example.com");
+    std::string_view urls[] = { "https://example.com/a", "https://example.com/b" };
+    guid from_urls[2];
+    guid::create_from_names(guid_namespace_url, urls, 2, from_urls);
+
+    // store sorted guids as a compact binary column and query it without loading it
+    guid_column::write("guids.bin", sorted.data(), sorted.data() + sorted.size(), guid_column_compression::prefix);
+    guid_column stored("guids.bin");
+    bool stored_found = stored.contains(g);
+    std::pair<std::size_t, std::size_t> stored_range = stored.range(guid(), g);
+    stored.close();
+
+    // pool of pre-generated guids, refilled by a background thread
+    guid_pool pool(4096);
+    guid pooled = pool.acquire();
+    // route guid::create_new() through the pool
+    pool.install();
+    guid from_pool = guid::create_new();
+    pool.uninstall();
+
     // Create a guid using guid::create member function
     guid g2;
     g2.create();
@@ -57,4 +124,327 @@ int main()
 
     guid g10("2AC3E955-939F-4756-8BC1-940BB7C882C3");
     assert(g10.empty() == false);
+
+    // version 4, variant 1
+    guid g11(createnew);
+    std::string s3 = g11.to_string('a');
+    assert(s3.length() == 36);
+    assert(s3[14] == '4');
+    assert(s3[19] == '8' || s3[19] == '9' || s3[19] == 'a' || s3[19] == 'b');
+    assert(guid::create_new() != guid::create_new());
+
+    guid g12("{2ac3e955-939f-4756-8bc1-940bb7c882c3}");
+    assert(g12 == g10);
+    guid g13("2AC3E955-939F-4756-8BC1-940BB7C882CZ");
+    assert(g13.empty());
+    guid g14(L"2AC3E955-939F-4756-8BC1-940BB7C882C3");
+    assert(g14 == g10);
+    assert(g14.to_wstring() == L"{2AC3E955-939F-4756-8BC1-940BB7C882C3}");
+
+    assert(ok);
+    guid g18 = guid::create_new();
+    guid g19;
+    assert(g19.from_chars(buffer, g18.to_chars(buffer, guid_format::uppercase) - buffer) && g19 == g18);
+    char buffer2[guid::max_string_length];
+    assert(g10.to_chars(buffer2, guid_format::uppercase) - buffer2 == 38);
+    assert(std::string(buffer2, 38) == "{2AC3E955-939F-4756-8BC1-940BB7C882C3}");
+    assert(g10.to_chars(buffer2, guid_format::lowercase_no_brackets) - buffer2 == 36);
+    assert(std::string(buffer2, 36) == "2ac3e955-939f-4756-8bc1-940bb7c882c3");
+    guid g15;
+    assert(g15.from_chars("{2ac3e955-939f-4756-8BC1-940BB7C882C3}", 38) && g15 == g10);
+    assert(!g15.from_chars("2ac3e955-939f-4756-8bc1-940bb7c882c", 35));
+    assert(!g15.from_chars("2ac3e955-939f-4756+8bc1-940bb7c882c3", 36));
+    assert(!g15.from_chars("2ac3e955-939f-4756-8bc1-940bb7c882g3", 36));
+    assert(!g15.from_chars("2ac3e955-939f-4756-8bc1-940bb7c8:2c3", 36));
+    assert(g15 == g10);
+    guid g16("00000000-0000-0000-0000-000000000000");
+    assert(g16.empty());
+    guid g17("FFFFFFFF-FFFF-FFFF-FFFF-FFFFFFFFFFFF");
+    assert(g17.to_string('a') == "ffffffff-ffff-ffff-ffff-ffffffffffff");
+
+    assert(version == guid_version::v7);
+    assert(g18.version() == guid_version::v4);
+    guid g20(createnew, guid_version::v7);
+    std::string s4 = g20.to_string('a');
+    assert(s4[14] == '7');
+    assert(s4[19] == '8' || s4[19] == '9' || s4[19] == 'a' || s4[19] == 'b');
+    std::string previous = s4;
+    for (int i = 0; i < 100000; i++)
+    {
+        std::string next = guid::create_new(guid_version::v7).to_string('a');
+        assert(next > previous);
+        previous = next;
+    }
+
+    assert(g10.hash() == g14.hash());
+    assert(std::hash<guid>()(g10) == g10.hash());
+    guid_map<int> map;
+    assert(map.empty() && map.find(g10) == map.end());
+    for (int i = 0; i < 1000; i++)
+        map[guid::create_new()] = i;
+    assert(map.insert(g10, 7).second);
+    assert(!map.insert(g10, 8).second);
+    assert(map.size() == 1001);
+    assert(map.at(g14) == 7);
+    assert(map.count(g10) == 1);
+    guid_map<int> map2 = map;
+    assert(map.erase(g10) == 1);
+    assert(map.erase(g10) == 0);
+    assert(!map.contains(g10));
+    assert(map.size() == 1000);
+    assert(map2.contains(g10) && map2.size() == 1001);
+    int visited = 0;
+    for (auto& entry : map)
+        visited += entry.second >= 0;
+    assert(visited == 1000);
+    guid_set set;
+    assert(set.insert(g10).second);
+    assert(!set.insert(g14).second);
+    assert(set.contains(g10) && set.size() == 1);
+    set.clear();
+    assert(set.empty() && !set.contains(g10));
+
+    assert(all_valid && column.size() == 2 && column[0] == g10 && column[1] == g10);
+    assert(count_guid_rows("a\nb\n") == 2);
+    assert(count_guid_rows("a\nb") == 2);
+    assert(!parse_guids(" 2ac3e955-939f-4756-8bc1-940bb7c882c3 \r\n\nxyz\n2ac3e955-939f-4756-8bc1-940bb7c882c3", column, errors));
+    assert(column.size() == 4 && column[0] == g10 && column[1].empty() && column[2].empty() && column[3] == g10);
+    assert(errors.size() == 2);
+    assert(errors[0].row == 1 && errors[0].offset == 40);
+    assert(errors[1].row == 2 && errors[1].offset == 41);
+    assert(parse_guids("2ac3e955-939f-4756-8bc1-940bb7c882c3,2ac3e955-939f-4756-8bc1-940bb7c882c3", column, errors, ','));
+    assert(column.size() == 2);
+
+    constexpr guid table[] = { "2ac3e955-939f-4756-8bc1-940bb7c882c3"_guid, "{6BA7B810-9DAD-11D1-80B4-00C04FD430C8}"_guid };
+    static_assert(table[1] == known, "");
+    static_assert(table[0] != known, "");
+    static_assert(table[0].version() == guid_version::v4, "");
+    static_assert(guid::parse("00000000-0000-0000-0000-000000000000").empty(), "");
+    assert(table[0] == g10);
+    assert(known.to_string('a') == "6ba7b810-9dad-11d1-80b4-00c04fd430c8");
+    try
+    {
+        guid::parse("6ba7b810-9dad-11d1-80b4-00c04fd430cx");
+        assert(false);
+    }
+    catch (std::invalid_argument&)
+    {
+    }
+
+    guid low("00000000-0000-0000-0000-000000000001");
+    guid high("10000000-0000-0000-0000-000000000000");
+    assert(low < high && high > low && low <= high && high >= low && low <= low && !(low < low));
+    assert(low.compare(high) == -1 && high.compare(low) == 1 && low.compare(low) == 0);
+    static_assert(guid(0, 1) < guid(1, 0), "");
+    std::vector<guid> many;
+    for (int i = 0; i < 10000; i++)
+        many.push_back(guid::create_new(i % 2 ? guid_version::v4 : guid_version::v7));
+    many.insert(many.end(), many.begin(), many.begin() + 100);
+    parallel_sort_guids(many.data(), many.data() + many.size(), 4);
+    for (size_t i = 1; i < many.size(); i++)
+        assert(many[i - 1] <= many[i]);
+    // inputs of at least 65536 guids per thread take the parallel partitioning path,
+    // v7 guids share their leading bytes and random ones do not
+    for (guid_version big_version : { guid_version::v4, guid_version::v7 })
+    {
+        std::vector<guid> big;
+        for (int i = 0; i < 4 * 65536 + 5000; i++)
+            big.push_back(guid::create_new(i % 3 ? big_version : guid_version::v4));
+        big.insert(big.end(), big.begin(), big.begin() + 1000);
+        std::vector<guid> expected_big = big;
+        std::sort(expected_big.begin(), expected_big.end());
+        parallel_sort_guids(big.data(), big.data() + big.size(), 4);
+        assert(big == expected_big);
+    }
+    guid* many_end = unique_guids(many.data(), many.data() + many.size());
+    assert(many_end - many.data() == 10000);
+    for (guid* p = many.data(); p != many_end; p++)
+        assert(find_sorted_guids(many.data(), many_end, *p) == p && lower_bound_guids(many.data(), many_end, *p) == p);
+    assert(find_sorted_guids(many.data(), many_end, guid()) == many_end);
+    assert(lower_bound_guids(many.data(), many_end, guid()) == many.data());
+
+    assert(from_name.to_string('a') == "2ed6657d-e927-568b-95e1-2665a8aea6a2");
+    assert(from_name.version() == guid_version::v5);
+    assert(guid::create_from_name(guid_namespace_dns, "www.example.com", guid_version::v3).to_string('a') == "5df41881-3aed-3515-88a7-2f4a814cf09e");
+    assert(from_urls[0] == guid::create_from_name(guid_namespace_url, "https://example.com/a"));
+    assert(from_urls[1] == guid::create_from_name(guid_namespace_url, "https://example.com/b"));
+    std::vector<std::string> keys;
+    for (int i = 0; i < 100; i++)
+        keys.push_back(std::string(i, 'k'));
+    std::vector<std::string_view> key_views(keys.begin(), keys.end());
+    std::vector<guid> key_guids(keys.size());
+    guid::create_from_names(guid_namespace_oid, key_views.data(), key_views.size(), key_guids.data());
+    for (size_t i = 0; i < keys.size(); i++)
+        assert(key_guids[i] == guid::create_from_name(guid_namespace_oid, keys[i]));
+    try
+    {
+        guid::create_from_name(guid_namespace_dns, "www.example.com", guid_version::v4);
+        assert(false);
+    }
+    catch (std::invalid_argument&)
+    {
+    }
+    for (guid_version name_based : { guid_version::v3, guid_version::v5 })
+    {
+        try
+        {
+            guid::create_new(name_based);
+            assert(false);
+        }
+        catch (std::invalid_argument&)
+        {
+        }
+        try
+        {
+            guid unnamed(createnew, name_based);
+            assert(false);
+        }
+        catch (std::invalid_argument&)
+        {
+        }
+    }
+
+    assert(stored_found == found);
+    assert(stored_range.first == 0 && stored_range.second <= sorted.size());
+    std::vector<guid> ordered_ids;
+    for (int i = 0; i < 1000; i++)
+        ordered_ids.push_back(guid::create_new(guid_version::v7));
+    for (guid_column_compression compression : { guid_column_compression::none, guid_column_compression::prefix })
+    {
+        guid_column::write("guids.bin", ordered_ids.data(), ordered_ids.data() + ordered_ids.size(), compression);
+        guid_column column_file("guids.bin");
+        assert(column_file.size() == 1000);
+        assert(column_file.compression() == compression);
+        for (size_t i = 0; i < ordered_ids.size(); i++)
+        {
+            assert(column_file[i] == ordered_ids[i]);
+            assert(column_file.contains(ordered_ids[i]));
+            assert(column_file.lower_bound(ordered_ids[i]) == i);
+            assert(column_file.upper_bound(ordered_ids[i]) == i + 1);
+        }
+        assert(!column_file.contains(guid()));
+        assert(column_file.range(ordered_ids[10], ordered_ids[19]) == std::make_pair(std::size_t(10), std::size_t(20)));
+        assert(column_file.range(ordered_ids[19], ordered_ids[10]).first == column_file.range(ordered_ids[19], ordered_ids[10]).second);
+    }
+    // bounds of values between and beyond the stored guids, with repeated guids
+    std::vector<guid> repeated_ids(ordered_ids.begin(), ordered_ids.begin() + 300);
+    repeated_ids.insert(repeated_ids.end(), ordered_ids.begin() + 100, ordered_ids.begin() + 200);
+    std::sort(repeated_ids.begin(), repeated_ids.end());
+    for (guid_column_compression compression : { guid_column_compression::none, guid_column_compression::prefix })
+    {
+        guid_column::write("guids.bin", repeated_ids.data(), repeated_ids.data() + repeated_ids.size(), compression);
+        guid_column column_file("guids.bin");
+        for (size_t i = 0; i < 400; i++)
+        {
+            guid probe = i % 2 == 0 ? ordered_ids[i] : guid(ordered_ids[i].high(), ordered_ids[i].low() + 1);
+            size_t lower = std::lower_bound(repeated_ids.begin(), repeated_ids.end(), probe) - repeated_ids.begin();
+            size_t upper = std::upper_bound(repeated_ids.begin(), repeated_ids.end(), probe) - repeated_ids.begin();
+            assert(column_file.range(probe, probe) == std::make_pair(lower, upper));
+        }
+    }
+
+    // empty columns and truncated or corrupt files
+    guid_column::write("guids.bin", ordered_ids.data(), ordered_ids.data(), guid_column_compression::prefix);
+    guid_column empty_column("guids.bin");
+    assert(empty_column.empty() && !empty_column.contains(ordered_ids[0]) && empty_column.lower_bound(ordered_ids[0]) == 0);
+    guid_column::write("guids.bin", ordered_ids.data(), ordered_ids.data() + ordered_ids.size(), guid_column_compression::prefix);
+    std::string column_bytes;
+    {
+        std::ifstream in("guids.bin", std::ios::binary);
+        column_bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    for (int corruption = 0; corruption < 3; corruption++)
+    {
+        std::string bytes = column_bytes;
+        if (corruption == 0)
+            bytes.resize(bytes.size() - 100);
+        else if (corruption == 1)
+            bytes[32 + 16 + 3] = 0x7F;
+        else
+            bytes[16] = (char)0xFF;
+        {
+            std::ofstream out("guids.bin", std::ios::binary | std::ios::trunc);
+            out.write(bytes.data(), (std::streamsize)bytes.size());
+        }
+        try
+        {
+            guid_column corrupt("guids.bin");
+            assert(false);
+        }
+        catch (std::runtime_error&)
+        {
+        }
+    }
+
+    std::swap(ordered_ids[0], ordered_ids[1]);
+    try
+    {
+        guid_column::write("guids.bin", ordered_ids.data(), ordered_ids.data() + ordered_ids.size());
+        assert(false);
+    }
+    catch (std::invalid_argument&)
+    {
+    }
+    std::remove("guids.bin");
+
+    // guid_pool hands out distinct version 4 guids in both refill modes
+    for (guid_pool_refill mode : { guid_pool_refill::background, guid_pool_refill::on_demand })
+    {
+        guid_pool ids(100, mode);
+        assert(ids.capacity() >= 100);
+        assert(ids.size() == ids.capacity());
+        guid_set seen;
+        for (int i = 0; i < 1000; i++)
+        {
+            guid id = ids.acquire();
+            assert(id.version() == guid_version::v4);
+            assert(seen.insert(id).second);
+        }
+        assert(ids.acquired() + ids.misses() >= 1000);
+
+        guid drained;
+        while (ids.try_acquire(drained))
+            assert(seen.insert(drained).second);
+        if (mode == guid_pool_refill::on_demand)
+        {
+            assert(ids.size() == 0);
+            ids.refill(10);
+            assert(ids.size() == 10);
+        }
+
+        ids.install();
+        assert(guid::generator() != nullptr);
+        guid installed = guid::create_new();
+        guid constructed(createnew);
+        assert(!installed.empty() && installed != constructed);
+    }
+    // destroying an installed pool restores the default generator
+    assert(guid::generator() == nullptr);
+    assert(guid::create_new().version() == guid_version::v4);
+
+#if !defined(_WIN32)
+    // a forked child discards the pool's guids instead of repeating the parent's
+    for (guid_pool_refill mode : { guid_pool_refill::background, guid_pool_refill::on_demand })
+    {
+        guid_pool ids(100, mode);
+        ids.install();
+        int channel[2];
+        assert(pipe(channel) == 0);
+        pid_t child = fork();
+        if (child == 0)
+        {
+            guid child_id = guid::create_new();
+            _exit(write(channel[1], &child_id, sizeof(child_id)) == sizeof(child_id) ? 0 : 1);
+        }
+        guid parent_id = guid::create_new();
+        guid child_id;
+        assert(read(channel[0], &child_id, sizeof(child_id)) == sizeof(child_id));
+        int status = 0;
+        waitpid(child, &status, 0);
+        assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+        assert(parent_id != child_id);
+        close(channel[0]);
+        close(channel[1]);
+    }
+#endif
 }
\ No newline at end of file
@@ -1,10 +1,357 @@
-#include "..\random_string.h"
+#include "../random_string.h"
+#include "../random_string_batch.h"
 
+#include <cassert>
 #include <string>
+#include <string_view>
+#include <unordered_set>
+#include <random>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
 #include <cstdio>
 
+// User defined compile-time alphabet
+struct dna
+{
+    static constexpr std::string_view chars = "ACGT";
+};
+
+// Generator whose 16-bit chunks count up from zero, so a fill consumes every chunk value once
+struct counting_generator
+{
+    using result_type = std::uint64_t;
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return ~(result_type)0; }
+    result_type operator()()
+    {
+        result_type word = 0;
+        for (int i = 0; i < 4; i++)
+            word |= (result_type)(chunk++ & 0xFFFF) << (i * 16);
+        return word;
+    }
+    std::uint64_t chunk = 0;
+};
+
 int main()
 {
+    /* api documentation */
+
+    // random string of lowercase letters and digits from a fast per thread generator
     std::string str = random_string(50);
     printf("%s", str.c_str());
-}
\ No newline at end of file
+    // any UniformRandomBitGenerator, seeded for reproducible fixtures
+    xoshiro256_engine engine(42);
+    std::string fixture = random_string(std::string("ACGT"), 20, engine);
+    // tokens and passwords should come from the operating system's secure generator
+    std::string token = random_string(32, secure);
+    // fill a caller buffer in bulk, every allowed character is exactly equally likely
+    std::vector<char> keys(1 << 20);
+    const char base36[] = "abcdefghijklmnopqrstuvwxyz0123456789";
+    random_string_fill(keys.data(), keys.data() + keys.size(), base36, 36);
+    // a million 16 character keys in one allocation, read back as string_views
+    random_string_batch batch = random_strings(1000000, 16);
+    std::string_view first_key = batch[0];
+    for (std::string_view key : batch)
+        (void)key;
+    // or into a caller supplied buffer
+    std::vector<char> arena(1000 * 8);
+    random_string_view hex_keys = random_strings(arena.data(), 1000, 8, "0123456789abcdef");
+    // reproducible datasets from a seed, generated on all cores, identical for any thread count
+    random_string_batch dataset = random_strings(10000000, 16, base36, 42);
+    // compile-time alphabets, predefined or user defined, pick their mapping at compile time
+    std::string request_id = random_string<alphabet::hex>(32);
+    std::string url_token = random_string<alphabet::base64url>(22, secure);
+    std::string strand = random_string<dna>(100);
+    random_string_batch session_ids = random_strings<alphabet::base62>(1000, 20);
+    // characters with relative weights, sampled in constant time from an alias table
+    weighted_alphabet skewed = { { 'a', 50 }, { 'b', 30 }, { 'c', 15 }, { 'd', 5 } };
+    std::string skewed_key = random_string(skewed, 12);
+    random_string_batch skewed_keys = random_strings(1000000, 12, skewed, 7);
+
+    /* tests */
+
+    // strings have the requested length and only use the allowed characters
+    std::string allowed1 = "abc";
+    for (int length : { 0, 1, 17, 1000 })
+    {
+        std::string str1 = random_string(allowed1, length);
+        assert((int)str1.length() == length && str1.find_first_not_of(allowed1) == std::string::npos);
+        std::string str2 = random_string(allowed1, length, secure);
+        assert((int)str2.length() == length && str2.find_first_not_of(allowed1) == std::string::npos);
+    }
+    assert(random_string(-1).empty());
+    assert(random_wstring(10).length() == 10 && random_u16string(10).length() == 10 && random_u32string(10).length() == 10);
+    assert(random_wstring(10, secure).length() == 10);
+
+    // seeded generators repeat, the default and secure generators do not
+    xoshiro256_engine engine3(7);
+    xoshiro256_engine engine4(7);
+    assert(engine3 == engine4 && random_string(64, engine3) == random_string(64, engine4));
+    assert(random_string(64, engine3) != random_string(64, xoshiro256_engine(8)));
+    assert(random_string(64) != random_string(64));
+    assert(random_string(64, secure) != random_string(64, secure));
+    std::mt19937 engine5(1);
+    assert(random_string(16, engine5).length() == 16);
+
+    // every character of the alphabet shows up with roughly equal frequency
+    std::string str8 = random_string(360000);
+    int counts8[256] = {};
+    for (char ch : str8)
+        counts8[(unsigned char)ch]++;
+    for (char ch : std::string("abcdefghijklmnopqrstuvwxyz0123456789"))
+        assert(counts8[(unsigned char)ch] > 9400 && counts8[(unsigned char)ch] < 10600);
+
+    // bulk fills only use the allowed characters and are uniform for every kind of alphabet,
+    // power of two, multiply-shift with rejection and above the vector kernel's 64
+    for (std::size_t size9 : { 2, 3, 16, 36, 62, 64, 100 })
+    {
+        std::string allowed9;
+        for (std::size_t i = 0; i < size9; i++)
+            allowed9.push_back((char)(i < 64 ? "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_"[i] : 128 + i));
+        for (std::size_t length9 : { 1, 31, 32, 33, 1023, 1024, 1000000 })
+        {
+            std::vector<char> buffer9(length9 + 1, '!');
+            xoshiro256_engine engine9(length9);
+            random_string_fill(buffer9.data(), buffer9.data() + length9, allowed9.data(), allowed9.size(), engine9);
+            assert(buffer9[length9] == '!');
+            std::vector<std::size_t> counts9(256);
+            for (std::size_t i = 0; i < length9; i++)
+                counts9[(unsigned char)buffer9[i]]++;
+            double expected9 = (double)length9 / size9;
+            double chi9 = 0;
+            std::size_t seen9 = 0;
+            for (char ch : allowed9)
+            {
+                seen9 += counts9[(unsigned char)ch];
+                chi9 += (counts9[(unsigned char)ch] - expected9) * (counts9[(unsigned char)ch] - expected9) / expected9;
+            }
+            assert(seen9 == length9);
+            // far beyond the 99.99th percentile of chi squared with size9 - 1 degrees of freedom
+            if (length9 == 1000000)
+                assert(chi9 < size9 + 10 * std::sqrt(2.0 * size9) + 20);
+        }
+    }
+    xoshiro256_engine engine10(3);
+    xoshiro256_engine engine11(3);
+    std::vector<char> buffer10(5000);
+    std::vector<char> buffer11(5000);
+    random_string_fill(buffer10.data(), buffer10.data() + buffer10.size(), "abc", 3, engine10);
+    random_string_fill(buffer11.data(), buffer11.data() + buffer11.size(), "abc", 3, engine11);
+    assert(buffer10 == buffer11 && engine10 == engine11);
+
+    // every 16-bit draw maps to exactly 65536 / 36 characters once the 16 rejected are skipped
+    std::u32string allowed12 = U"abcdefghijklmnopqrstuvwxyz0123456789";
+    std::u32string str12 = random_string(allowed12, 65520, counting_generator());
+    std::vector<int> counts12(128);
+    for (char32_t ch : str12)
+        counts12[ch]++;
+    for (char32_t ch : allowed12)
+        assert(counts12[ch] == 1820);
+    bool threw13 = false;
+    try
+    {
+        random_string(std::string(), 5);
+    }
+    catch (const std::invalid_argument&)
+    {
+        threw13 = true;
+    }
+    assert(threw13 && random_string(std::string(), 0).empty());
+
+    // batches hold count strings of the requested length back to back
+    random_string_batch batch14 = random_strings(10000, 12, "ab");
+    assert(batch14.size() == 10000 && batch14.length() == 12 && !batch14.empty());
+    std::size_t visited14 = 0;
+    for (std::string_view key : batch14)
+    {
+        assert(key.data() == batch14.data() + visited14 * 12 && key.length() == 12);
+        assert(key.find_first_not_of("ab") == std::string_view::npos);
+        visited14++;
+    }
+    assert(visited14 == 10000 && batch14[9999] == batch14.at(9999));
+    bool threw14 = false;
+    try
+    {
+        batch14.at(10000);
+    }
+    catch (const std::out_of_range&)
+    {
+        threw14 = true;
+    }
+    assert(threw14);
+    std::unordered_set<std::string_view> unique15(batch14.begin(), batch14.end());
+    assert(unique15.size() > 3000);
+    random_string_batch batch16 = random_strings(100, 0);
+    assert(batch16.size() == 100 && batch16[5].empty() && std::distance(batch16.begin(), batch16.end()) == 100);
+    assert(random_strings(0, 10).empty());
+
+    // the same seed fills the caller's buffer and an owned batch identically
+    std::vector<char> buffer17(500 * 20);
+    random_string_view view17 = random_strings(buffer17.data(), 500, 20, "0123456789", xoshiro256_engine(17));
+    random_string_batch batch17 = random_strings(500, 20, "0123456789", xoshiro256_engine(17));
+    assert(view17.size() == 500 && view17.data() == buffer17.data());
+    for (std::size_t i = 0; i < 500; i++)
+        assert(view17[i] == batch17[i]);
+    random_string_view copy17 = batch17;
+    assert(copy17.data() == batch17.data() && copy17.size() == batch17.size());
+
+    // seeded batches do not depend on the number of threads generating them
+    std::string allowed18 = "abcdefghijklmnopqrstuvwxyz0123456789";
+    random_string_batch batch18 = random_strings(100000, 13, allowed18, 2024, 1);
+    for (unsigned threads : { 2u, 3u, 7u, 0u })
+    {
+        random_string_batch other18 = random_strings(100000, 13, allowed18, 2024, threads);
+        assert(std::equal(batch18.data(), batch18.data() + 100000 * 13, other18.data()));
+    }
+    random_string_batch seed19 = random_strings(100000, 13, allowed18, 2025, 4);
+    assert(!std::equal(batch18.data(), batch18.data() + 100000 * 13, seed19.data()));
+    for (std::string_view key : seed19)
+        assert(key.find_first_not_of(allowed18) == std::string_view::npos);
+
+    // block boundaries fall inside strings, the filled range is exact
+    std::vector<char> buffer20(random_string_block_size * 3 + 5 + 1, '!');
+    random_string_view view20 = random_strings(buffer20.data(), random_string_block_size * 3 + 5, 1, "xy", 7, 2);
+    assert(view20.size() == random_string_block_size * 3 + 5 && buffer20.back() == '!');
+    assert(buffer20.end()[-2] == 'x' || buffer20.end()[-2] == 'y');
+    std::vector<char32_t> buffer21(1000);
+    std::vector<char32_t> buffer22(1000);
+    random_string_fill(buffer21.data(), buffer21.data() + 1000, U"xyz", 3, 5, 3);
+    random_string_fill(buffer22.data(), buffer22.data() + 1000, U"xyz", 3, 5, 1);
+    assert(buffer21 == buffer22 && buffer21[0] >= U'x' && buffer21[0] <= U'z');
+    assert(random_strings(0, 10, allowed18, 1).empty());
+
+    // compile-time alphabets produce what the same alphabet given at run time does
+    for (int length23 : { 0, 5, 31, 32, 100, 5000 })
+    {
+        assert(random_string<alphabet::base36>(length23, xoshiro256_engine(23)) == random_string(std::string(alphabet::base36::chars), length23, xoshiro256_engine(23)));
+        assert(random_string<alphabet::hex>(length23, xoshiro256_engine(23)) == random_string(std::string("0123456789abcdef"), length23, xoshiro256_engine(23)));
+        assert(random_string<dna>(length23, xoshiro256_engine(23)) == random_string(std::string("ACGT"), length23, xoshiro256_engine(23)));
+    }
+    assert(random_string<alphabet::digits>(64).find_first_not_of("0123456789") == std::string::npos);
+    assert(random_string<alphabet::uppercase_hex>(64).find_first_not_of("0123456789ABCDEF") == std::string::npos);
+    assert(random_string<alphabet::lowercase>(64, secure).find_first_not_of("abcdefghijklmnopqrstuvwxyz") == std::string::npos);
+    assert(random_string<alphabet::base64url>(64).find_first_not_of(alphabet::base64url::chars) == std::string::npos);
+    static_assert(alphabet::base62::chars.size() == 62 && alphabet::base64url::chars.size() == 64, "alphabet sizes");
+    std::u32string wide24 = random_string<random_string_base36<char32_t>>(40);
+    assert(wide24.length() == 40 && wide24.find_first_not_of(random_string_base36<char32_t>::chars) == std::u32string::npos);
+
+    // and batches from compile-time alphabets match their run time counterparts too
+    random_string_batch batch25 = random_strings<alphabet::base62>(20000, 10, 99, 3);
+    random_string_batch batch26 = random_strings(20000, 10, alphabet::base62::chars, 99, 1);
+    assert(std::equal(batch25.data(), batch25.data() + 20000 * 10, batch26.data()));
+    random_string_batch batch27 = random_strings<dna>(100, 7, xoshiro256_engine(4));
+    random_string_batch batch28 = random_strings(100, 7, "ACGT", xoshiro256_engine(4));
+    assert(std::equal(batch27.data(), batch27.data() + 700, batch28.data()));
+    assert(random_strings<alphabet::hex>(10, 4).size() == 10);
+
+    // alias tables represent the weights, zero weights never come up
+    const double weights29[] = { 12.7, 9.1, 8.2, 7.5, 7.0, 0.0, 6.3, 0.07, 3.0 };
+    weighted_alphabet english29("etaoinshr", weights29);
+    double total29 = 0;
+    for (double weight : weights29)
+        total29 += weight;
+    assert(english29.size() == 9 && english29.columns() == 16 && english29.chars() == "etaoinshr");
+    for (std::size_t i = 0; i < 9; i++)
+        assert(std::fabs(english29.probability(i) - weights29[i] / total29) < 1e-7);
+    std::vector<char> buffer29(2000000);
+    random_string_fill(buffer29.data(), buffer29.data() + buffer29.size(), english29, xoshiro256_engine(29));
+    std::vector<std::size_t> counts29(256);
+    for (char ch : buffer29)
+        counts29[(unsigned char)ch]++;
+    double chi29 = 0;
+    for (std::size_t i = 0; i < 9; i++)
+    {
+        double expected = buffer29.size() * english29.probability(i);
+        if (weights29[i] == 0)
+            assert(counts29[(unsigned char)"etaoinshr"[i]] == 0);
+        else
+            chi29 += (counts29[(unsigned char)"etaoinshr"[i]] - expected) * (counts29[(unsigned char)"etaoinshr"[i]] - expected) / expected;
+    }
+    assert(chi29 < 60);
+
+    // generators other than xoshiro256_engine feed 32 bits per character to either path in order
+    std::mt19937_64 engine30(30);
+    std::mt19937_64 engine31(30);
+    std::string str30 = random_string(english29, 1000, engine30);
+    for (std::size_t i = 0; i < str30.length(); i += 2)
+    {
+        std::uint64_t word = engine31();
+        for (std::size_t j = i; j < i + 2 && j < str30.length(); j++)
+        {
+            std::uint32_t random = (std::uint32_t)(word >> ((j - i) * 32));
+            std::uint32_t column = random & (std::uint32_t)(english29.columns() - 1);
+            std::uint32_t pair = english29.pairs()[column];
+            assert(str30[j] == (char)((random >> 8) < english29.thresholds()[column] ? pair : pair >> 8));
+        }
+    }
+
+    // single characters, full 256 character alphabets and invalid weights
+    weighted_alphabet single32 = { { 'z', 0.5 } };
+    assert(random_string(single32, 100) == std::string(100, 'z'));
+    std::string all33;
+    std::vector<double> weights33;
+    for (int i = 0; i < 256; i++)
+    {
+        all33.push_back((char)i);
+        weights33.push_back(i + 1.0);
+    }
+    weighted_alphabet full33(all33, weights33.data());
+    assert(full33.columns() == 256 && random_string(full33, 5000, secure).length() == 5000);
+    const double negative34[] = { 1.0, -1.0 };
+    const double zero34[] = { 0.0, 0.0 };
+    int threw34 = 0;
+    for (const double* weights : { negative34, zero34 })
+    {
+        try
+        {
+            weighted_alphabet invalid("ab", weights);
+        }
+        catch (const std::invalid_argument&)
+        {
+            threw34++;
+        }
+    }
+    assert(threw34 == 2);
+
+    // weighted batches follow the same seeded and buffer paths as uniform ones
+    random_string_batch batch35 = random_strings(50000, 9, english29, 35, 1);
+    random_string_batch batch36 = random_strings(50000, 9, english29, 35, 4);
+    assert(std::equal(batch35.data(), batch35.data() + 50000 * 9, batch36.data()));
+    std::vector<char> buffer37(100 * 6);
+    random_string_view view37 = random_strings(buffer37.data(), 100, 6, english29, xoshiro256_engine(37));
+    random_string_batch batch37 = random_strings(100, 6, english29, xoshiro256_engine(37));
+    assert(view37.size() == 100 && std::equal(buffer37.begin(), buffer37.end(), batch37.data()));
+    for (std::string_view key : random_strings(1000, 4, english29))
+        assert(key.find('n') == std::string_view::npos);
+
+    // errors in seeded batches reach the caller whichever thread they happen on
+    for (unsigned threads38 : { 1u, 4u })
+    {
+        int threw38 = 0;
+        try
+        {
+            random_strings(1000000, 16, "", 7, threads38);
+        }
+        catch (const std::invalid_argument&)
+        {
+            threw38++;
+        }
+        std::vector<char> buffer38(random_string_block_size * 4);
+        try
+        {
+            random_string_fill_blocks(buffer38.data(), buffer38.data() + buffer38.size(), 38, threads38, [&](char* begin, char*, xoshiro256_engine&)
+            {
+                if (begin != buffer38.data())
+                    throw std::runtime_error("block failed");
+            });
+        }
+        catch (const std::runtime_error&)
+        {
+            threw38++;
+        }
+        assert(threw38 == 2);
+    }
+}
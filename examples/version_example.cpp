@@ -1,7 +1,20 @@
-#include "..\version.h"
+#include "../version.h"
+#include "../version_algorithm.h"
+#include "../version_range.h"
+#include "../version_table.h"
+#include "../version_index.h"
 
 #include <cassert>
 #include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+#include <unordered_set>
+#include <cstdint>
+#include <memory>
+#include <cstring>
+#include <type_traits>
+#include <cstdio>
 
 int main()
 {
@@ -14,15 +27,53 @@ int main()
     int minor = ver.minor();
     int rev = ver.revision();
     int build = ver.build();
-    std::string release = ver.release();
+    std::string_view release = ver.release();
     // get the number of set components
     int fields = ver.fields();
     // convert the version to string
     std::string str = ver.to_string();
+    // or write it into a buffer without allocating
+    char buffer[64];
+    version_to_chars_result written = ver.to_chars(buffer, buffer + sizeof(buffer));
     // clearing the version
     ver.clear();
     // construction from strings like 1.0.7-rc2
     ver = version(str);
+    // parsing without exceptions, on failure ptr points at the offending character
+    std::string_view text = "2.4.1-beta";
+    version_from_chars_result parsed = version::from_chars(text.data(), text.data() + text.size(), ver);
+    bool parsed_ok = parsed.ec == std::errc();
+    // packed order preserving key, comparing keys is the same as comparing versions
+    std::uint64_t key = ver.key();
+    // sort a large array of versions, or of keys with their release tags alongside
+    std::vector<version> versions = { version(2, 0), version(1, 4, 2), version(1, 4, "beta") };
+    sort_versions(versions.data(), versions.data() + versions.size());
+    // format a whole array into one string, or into a fixed buffer in chunks
+    std::string report = format_versions(versions.data(), versions.data() + versions.size(), ", ");
+    // compile a constraint once and evaluate it against single versions or whole arrays
+    version_range range(">=1.2.0 <2.0.0 || ~3.4");
+    bool satisfied = range.contains(version(1, 4, 2));
+    const version* newest = range.max_satisfying(versions.data(), versions.data() + versions.size());
+    // load a manifest of "name version" lines into columns, malformed lines are reported
+    std::FILE* manifest = std::fopen("manifest.txt", "wb");
+    std::fputs("zlib 1.3.1\nopenssl 3.0.13-beta\n", manifest);
+    std::fclose(manifest);
+    version_table table;
+    std::vector<version_parse_error> errors;
+    bool loaded = table.load("manifest.txt", errors);
+    std::string_view package = table.name(1);
+    version package_version = table[1];
+    // versions known at compile time, checks against them fold to integer compares
+    constexpr version minimum = "2.4.1-rc1"_ver;
+    static_assert("2.4.1"_ver < minimum, "a release tag sorts after the plain version");
+    bool supported = version(2, 5) >= minimum;
+    // sorted index answering predecessor, successor, range and latest per major queries
+    version_index index(versions.data(), versions.data() + versions.size());
+    const version* below = index.predecessor(version(2, 0));
+    const version* above = index.successor(version(1, 4, 2));
+    std::pair<const version*, const version*> major_one = index.range(1);
+    const version* latest_one = index.latest(1);
+    std::vector<version> latest = index.latest_per_major();
 
     /* tests */
 
@@ -119,6 +170,339 @@ int main()
     assert(ver25 == ver24);
     ver25.clear();
     version ver26;
-    ver26.swap(version(ver24));
+    version ver27(ver24);
+    ver26.swap(ver27);
     assert(ver26 == version(ver24));
-}
\ No newline at end of file
+
+    version ver28;
+    std::string_view text28 = "1.20.300.4000-rc.1";
+    version_from_chars_result result28 = version::from_chars(text28.data(), text28.data() + text28.size(), ver28);
+    assert(result28.ec == std::errc() && result28.ptr == text28.data() + text28.size());
+    assert(ver28.major() == 1 && ver28.minor() == 20 && ver28.revision() == 300 && ver28.build() == 4000);
+    assert(ver28.release() == "rc.1");
+    assert(ver28.fields() == 5);
+    assert(version::parse("3").fields() == 2);
+    assert(version::parse("3 beta", " ").release() == "beta");
+
+    const char* invalid[] = { "1.2x", "1.", ".1", "-1.0", "1.2.3.4.5", "1.+2", " 1.0" };
+    std::size_t positions[] = { 3, 2, 0, 0, 7, 2, 0 };
+    for (int i = 0; i < 7; i++)
+    {
+        std::string_view text29 = invalid[i];
+        version ver29(2, 0);
+        version_from_chars_result result29 = version::from_chars(text29.data(), text29.data() + text29.size(), ver29);
+        assert(result29.ec == std::errc::invalid_argument);
+        assert(result29.ptr == text29.data() + positions[i]);
+        assert(ver29 == version(2, 0));
+        try
+        {
+            version::parse(text29);
+            assert(false);
+        }
+        catch (const version_parse_exception& e)
+        {
+            assert(e.position() == positions[i]);
+        }
+    }
+    std::string_view text30 = "1.99999999999";
+    version_from_chars_result result30 = version::from_chars(text30.data(), text30.data() + text30.size(), ver28);
+    assert(result30.ec == std::errc::result_out_of_range && result30.ptr == text30.data() + 2);
+    assert(!version::try_parse("1.65536", ver28));
+    assert(version::try_parse("32767.65535.65535.65535", ver28));
+    assert(!version::try_parse("32768.0", ver28));
+
+    // key ordering matches compare
+    version ver31(1, 0, 0, 0, "rc1");
+    version ver32(1, 0, 0, 0, "rc2");
+    assert(ver4.key() < ver10.key());
+    assert(ver10 != ver4 && ver4 != ver10);
+    assert(ver10 > ver4 && ver10.compare(ver4) == 1);
+    assert(ver31 == ver32 && ver31.key() == ver10.key());
+    assert(version(1, 65535).key() < version(2, 0).key());
+    assert(version(1, 2, 3, 4) > version(1, 2, 3) && version(1, 2, 4) > version(1, 2, 3, 65535));
+    assert(ver4.hash() == ver5.hash() && std::hash<version>()(ver4) == ver4.hash());
+    std::unordered_set<version> set = { ver1, ver2, ver4, ver5 };
+    assert(set.size() == 3);
+    try
+    {
+        version ver33(1, 65536);
+        assert(false);
+    }
+    catch (std::out_of_range&)
+    {
+    }
+    try
+    {
+        version ver34(-1, 0);
+        assert(false);
+    }
+    catch (std::out_of_range&)
+    {
+    }
+    assert((version(1, 65530) + 10).minor() == 65535);
+    assert((version(32760, 0) + version(10, 0)).major() == 32767);
+
+    std::vector<version> unsorted;
+    for (int i = 0; i < 1000; i++)
+        unsorted.push_back(version((i * 37) % 5, (i * 11) % 7, (i * 13) % 1000, std::to_string(i)));
+    std::vector<version> sorted = unsorted;
+    sort_versions(sorted.data(), sorted.data() + sorted.size());
+    std::vector<std::uint64_t> keys;
+    std::vector<std::string> releases;
+    for (const version& v : unsorted)
+    {
+        keys.push_back(v.key());
+        releases.emplace_back(v.release());
+    }
+    sort_versions(keys.data(), releases.data(), keys.size());
+    for (std::size_t i = 0; i < sorted.size(); i++)
+    {
+        assert(sorted[i].key() == keys[i]);
+        assert(sorted[i].release() == releases[i]);
+        if (i > 0)
+        {
+            assert(sorted[i - 1] <= sorted[i]);
+            // equal keys keep their original order
+            if (sorted[i - 1] == sorted[i])
+                assert(std::stoi(std::string(sorted[i - 1].release())) < std::stoi(std::string(sorted[i].release())));
+        }
+    }
+
+    version_range range35(">=1.2.0 <2.0.0 || ~3.4");
+    assert(range35.intervals().size() == 2);
+    assert(range35.contains(version(1, 2)) && range35.contains(version(1, 99, 3, 7)) && !range35.contains(version(2, 0)));
+    assert(range35.contains(version(3, 4, 9)) && !range35.contains(version(3, 5)) && !range35.contains(version(1, 1, 9)));
+    assert(version_range("^1.2.3").contains(version(1, 9)) && !version_range("^1.2.3").contains(version(2, 0)));
+    assert(version_range("^0.2.3").contains(version(0, 2, 9)) && !version_range("^0.2.3").contains(version(0, 3)));
+    assert(version_range("~1").contains(version(1, 9)) && !version_range("~1").contains(version(2, 0)));
+    assert(version_range("1.2.x").contains(version(1, 2, 99)) && !version_range("1.2.x").contains(version(1, 3)));
+    assert(version_range("<=1.2.x").contains(version(1, 2, 9)) && !version_range("<=1.2.x").contains(version(1, 3)));
+    assert(version_range("*").contains(version(7, 1)) && version_range("").contains(version(7, 1)));
+    assert(version_range(">= 1.0 < 1.5").contains(version(1, 4)));
+    assert(version_range("1.2").contains(version(1, 2, 0)) && !version_range("1.2").contains(version(1, 2, 1)));
+    assert(version_range("1.0.0-rc1").contains(version(1, 0, 0, "rc2")) && !version_range("1.0.0-rc1").contains(version(1, 0, 0)));
+    assert(version_range("<0").empty() && version_range().empty());
+    assert(version_range("<1 || >=1").intervals().size() == 1);
+
+    const char* invalid_ranges[] = { ">=", "1.2 | 3", ">=1.a", "1.x-rc" };
+    std::size_t range_positions[] = { 2, 4, 4, 2 };
+    for (int i = 0; i < 4; i++)
+    {
+        version_range range36;
+        assert(!version_range::try_parse(invalid_ranges[i], range36));
+        try
+        {
+            version_range::parse(invalid_ranges[i]);
+            assert(false);
+        }
+        catch (const version_parse_exception& e)
+        {
+            assert(e.position() == range_positions[i]);
+        }
+    }
+
+    // batch evaluation agrees with single evaluation
+    std::vector<std::uint64_t> catalog;
+    for (int i = 0; i < 1003; i++)
+        catalog.push_back(version(i % 7, (i * 3) % 11, i % 5).key());
+    std::unique_ptr<bool[]> matched(new bool[catalog.size()]);
+    range35.contains(catalog.data(), catalog.size(), matched.get());
+    std::size_t matching = 0;
+    std::uint64_t max_matching = 0;
+    std::uint64_t min_matching = ~0ull;
+    for (std::size_t i = 0; i < catalog.size(); i++)
+    {
+        assert(matched[i] == range35.contains(catalog[i]));
+        if (matched[i])
+        {
+            matching++;
+            max_matching = catalog[i] > max_matching ? catalog[i] : max_matching;
+            min_matching = catalog[i] < min_matching ? catalog[i] : min_matching;
+        }
+    }
+    assert(matching > 0 && range35.count(catalog.data(), catalog.size()) == matching);
+    assert(*range35.max_satisfying(catalog.data(), catalog.data() + catalog.size()) == max_matching);
+    assert(*range35.min_satisfying(catalog.data(), catalog.data() + catalog.size()) == min_matching);
+    assert(version_range("9").max_satisfying(catalog.data(), catalog.data() + catalog.size()) == catalog.data() + catalog.size());
+    const version* newest37 = range35.max_satisfying(sorted.data(), sorted.data() + sorted.size());
+    assert(newest37->major() == 3 && newest37->minor() == 4);
+    assert(range35.min_satisfying(sorted.data(), sorted.data() + sorted.size())->key() >= version(1, 2).key());
+
+    // compact layout, versions can be copied as raw bytes
+    static_assert(sizeof(version) == 16, "version is expected to take 16 bytes");
+    static_assert(std::is_trivially_copyable<version>::value, "version is expected to be trivially copyable");
+    version ver38(4, 3, 2, 1, "release-candidate-0001");
+    assert(ver38.release() == "release-candidate-0001");
+    version ver39;
+    std::memcpy(&ver39, &ver38, sizeof(version));
+    assert(ver39 == ver38 && ver39.release() == ver38.release() && ver39.fields() == 5);
+    std::string_view text41 = "1.0-a-much-longer-release-candidate-tag";
+    version_from_chars_result result41 = version::from_chars(text41.data(), text41.data() + text41.size(), ver39);
+    assert(result41.ec == std::errc() && ver39.release() == "a-much-longer-release-candidate-tag");
+    version ver42(1, 2, "beta");
+    ver42.clear();
+    assert(ver42.empty() && ver42.release().empty());
+
+    // release tags are interned, equal tags share a handle
+    version_release_pool& pool = version_release_pool::instance();
+    assert(version(1, 0, "beta").release_handle() == version::parse("2.0-beta").release_handle());
+    assert(version(1, 0, "beta").release_handle() == version_release_pool::well_known_handle("beta"));
+    assert(version(1, 0, "tag-43").release_handle() == version::parse("3.1-tag-43").release_handle());
+    assert(version(1, 0, "tag-43").release_handle() != version(1, 0, "tag-44").release_handle());
+    assert(pool.tag(version::parse("3.1-tag-43").release_handle()) == "tag-43");
+    assert(pool.tag(0).empty() && pool.tag(version_release_pool::well_known_handle("rc1")) == "rc1");
+    std::uint32_t handle43 = 0;
+    assert(pool.try_find("tag-43", handle43) && pool.intern("tag-43") == handle43);
+    assert(!pool.try_find("tag-never-seen", handle43));
+    std::size_t pool_size = pool.size();
+    for (int i = 0; i < 1000; i++)
+        version::parse("1.0-beta");
+    assert(pool.size() == pool_size);
+    assert(version_release_pool::well_known_handle("not-well-known") == version_release_pool::max_size);
+
+    // manifests are parsed into columns, in parallel chunks, with per line errors
+    std::string manifest_text;
+    for (int i = 0; i < 20000; i++)
+    {
+        if (i % 5000 == 7)
+            manifest_text += "broken 1..2\n";
+        else if (i % 5000 == 11)
+            manifest_text += "   \r\n";
+        else
+            manifest_text += "  package" + std::to_string(i) + "\t" + std::to_string(i % 9) + "." + std::to_string(i % 100) + (i % 3 == 0 ? "-rc1" : "") + (i % 2 == 0 ? "\r\n" : "\n");
+    }
+    manifest_text += "missing";
+    version_table table43;
+    std::vector<version_parse_error> errors43;
+    assert(!table43.parse(manifest_text, errors43, 4));
+    assert(table43.size() == 20000 - 8);
+    assert(errors43.size() == 5);
+    assert(errors43[0].line == 7 && manifest_text.compare(errors43[0].offset, 3, ".2\n") == 0);
+    assert(errors43[4].line == 20000 && errors43[4].offset == manifest_text.size());
+    assert(table43.name(0) == "package0" && table43[0] == version(0, 0, "rc1") && table43[0].release() == "rc1");
+    assert(table43.name(1) == "package1" && table43[1].to_string() == "1.1");
+    assert(table43.key(3) == table43[3].key() && table43.releases()[1] == version::no_release);
+    version_table table44;
+    std::vector<version_parse_error> errors44;
+    table44.parse(manifest_text, errors44, 1);
+    assert(table44.size() == table43.size() && errors44.size() == errors43.size());
+    for (std::size_t i = 0; i < table43.size(); i++)
+        assert(table43.name(i) == table44.name(i) && table43.key(i) == table44.key(i) && table43[i].to_string() == table44[i].to_string());
+    for (std::size_t i = 0; i < errors43.size(); i++)
+        assert(errors43[i].line == errors44[i].line && errors43[i].offset == errors44[i].offset);
+
+    manifest = std::fopen("manifest.txt", "wb");
+    std::fwrite(manifest_text.data(), 1, manifest_text.size(), manifest);
+    std::fclose(manifest);
+    version_table table45;
+    assert(!table45.load("manifest.txt", errors44));
+    assert(table45.size() == table43.size() && table45.name(table45.size() - 1) == table43.name(table43.size() - 1));
+    std::remove("manifest.txt");
+
+    // constexpr versions and the _ver literal
+    constexpr version ver46 = "2.4.1-rc1"_ver;
+    static_assert(ver46.major() == 2 && ver46.minor() == 4 && ver46.revision() == 1 && ver46.build() == 0, "fields of a version literal");
+    static_assert(ver46.fields() == 4, "field count of a version literal");
+    static_assert(ver46.key() == version::pack(2, 4, 1, 0, true), "key of a version literal");
+    static_assert(ver46.release_handle() == version_release_pool::well_known_handle("rc1"), "release handle of a version literal");
+    static_assert("1.2"_ver == "1.2.0.0"_ver && "1.2"_ver.fields() == 2, "partial version literals");
+    static_assert("1.2"_ver < "1.2.1"_ver && "1.2.1"_ver.compare("1.2"_ver) == 1, "version literal ordering");
+    static_assert("32767.65535.65535.65535-SNAPSHOT"_ver.key() == ~0ull, "largest version literal");
+    static_assert(version(3, 1, 4) == "3.1.4"_ver && version(3, 1, 4, 1, 4, version::no_release) == "3.1.4.1"_ver, "constexpr constructors");
+    static_assert("7"_ver.empty() == false && version().empty(), "empty versions");
+    assert(ver46 == version(2, 4, 1, "rc1") && ver46.release() == "rc1");
+    assert(ver46.to_string() == version::parse("2.4.1-rc1").to_string());
+    const char* invalid_literals[] = { "1..2", "1.2x", "1.65536", "1.0-not-well-known", "" };
+    std::size_t literal_positions[] = { 2, 3, 2, 4, 0 };
+    for (int i = 0; i < 5; i++)
+    {
+        try
+        {
+            version::parse_constant(invalid_literals[i]);
+            assert(false);
+        }
+        catch (const version_parse_exception& e)
+        {
+            assert(e.position() == literal_positions[i]);
+        }
+    }
+
+    // version_index agrees with searches over the sorted array
+    std::vector<version> catalog47;
+    for (int i = 0; i < 5000; i++)
+        catalog47.push_back(version((i * 7) % 6, (i * 13) % 9, i % 11, i % 2 == 0 ? "rc1" : "beta"));
+    version_index index47(catalog47.data(), catalog47.data() + 2500);
+    index47.insert(catalog47.data() + 2500, catalog47.data() + catalog47.size());
+    std::vector<version> sorted47 = catalog47;
+    sort_versions(sorted47.data(), sorted47.data() + sorted47.size());
+    assert(index47.size() == sorted47.size());
+    for (std::size_t i = 0; i < sorted47.size(); i++)
+        assert(index47[i] == sorted47[i]);
+    for (int major = 0; major < 8; major++)
+    {
+        for (int minor = 0; minor < 10; minor++)
+        {
+            version probe(major, minor, 5);
+            std::size_t lower = (std::size_t)(std::lower_bound(sorted47.begin(), sorted47.end(), probe) - sorted47.begin());
+            std::size_t upper = (std::size_t)(std::upper_bound(sorted47.begin(), sorted47.end(), probe) - sorted47.begin());
+            assert(index47.lower_bound(probe) == lower && index47.upper_bound(probe) == upper);
+            assert(lower == 0 ? index47.predecessor(probe) == nullptr : *index47.predecessor(probe) == sorted47[lower - 1]);
+            assert(upper == sorted47.size() ? index47.successor(probe) == nullptr : *index47.successor(probe) == sorted47[upper]);
+        }
+        std::pair<const version*, const version*> span = index47.range(major);
+        std::size_t in_major = 0;
+        for (const version& v : sorted47)
+            in_major += v.major() == major ? 1 : 0;
+        assert((std::size_t)(span.second - span.first) == in_major);
+        assert(in_major == 0 ? index47.latest(major) == nullptr : index47.latest(major)->major() == major && index47.latest(major) == span.second - 1);
+    }
+    std::vector<version> latest47 = index47.latest_per_major();
+    assert(latest47.size() == 6 && latest47[0].major() == 0 && latest47[5] == sorted47.back());
+    std::pair<const version*, const version*> span47 = index47.range(version(2, 2), version(2, 5, 99));
+    for (const version* v = span47.first; v != span47.second; v++)
+        assert(*v >= version(2, 2) && *v <= version(2, 5, 99));
+    assert(span47.first != span47.second && index47.contains(*span47.first) && !index47.contains(version(7, 0)));
+    version_range range47(">=1.2 <3 || ~4.1");
+    assert(index47.max_satisfying(range47)->key() == range47.max_satisfying(sorted47.data(), sorted47.data() + sorted47.size())->key());
+    assert(index47.min_satisfying(range47)->key() == range47.min_satisfying(sorted47.data(), sorted47.data() + sorted47.size())->key());
+    assert(index47.max_satisfying(version_range("9")) == nullptr);
+    version_index empty47;
+    assert(empty47.empty() && empty47.lower_bound(version(1, 0)) == 0 && empty47.predecessor(version(1, 0)) == nullptr && empty47.latest_per_major().empty());
+
+    // to_chars and format_versions agree with to_string
+    version ver48(3, 10, 200, 4000, "rc1");
+    char buffer48[64];
+    version_to_chars_result written48 = ver48.to_chars(buffer48, buffer48 + sizeof(buffer48));
+    assert(written48.ec == std::errc() && std::string(buffer48, written48.ptr) == "3.10.200.4000-rc1");
+    written48 = ver48.to_chars(buffer48, buffer48 + sizeof(buffer48), 2, false);
+    assert(std::string(buffer48, written48.ptr) == "3.10");
+    written48 = ver48.to_chars(buffer48, buffer48 + 16);
+    assert(written48.ec == std::errc::value_too_large && written48.ptr == buffer48 + 16);
+    assert(version(32767, 65535, 65535, 65535).to_string().length() == version::max_numeric_chars);
+    assert(ver48.to_string(3) == "3.10.200-rc1" && ver48.to_string(3, false) == "3.10.200");
+    assert(version(1, 2).to_string(4, true) == "1.2.0.0" && ver48.to_string(5, false, "+") == "3.10.200.4000+rc1");
+    std::vector<version> list48;
+    std::string expected48;
+    for (int i = 0; i < 1000; i++)
+    {
+        list48.push_back(i % 3 == 0 ? version(i % 7, i, i % 13, "beta") : version(i % 7, i % 100, i));
+        expected48 += (i == 0 ? "" : "; ") + list48.back().to_string();
+    }
+    assert(format_versions(list48.data(), list48.data() + list48.size(), "; ") == expected48);
+    assert(format_versions(list48.data(), list48.data()).empty());
+    for (std::size_t capacity = 16; capacity < 48; capacity++)
+    {
+        std::string streamed48;
+        const version* next48 = list48.data();
+        for (;;)
+        {
+            version_format_result chunk = format_versions(next48, list48.data() + list48.size(), buffer48, buffer48 + capacity, "; ");
+            assert(chunk.ptr != buffer48 || chunk.ec == std::errc());
+            streamed48.append(buffer48, chunk.ptr);
+            next48 = chunk.next;
+            if (chunk.ec == std::errc())
+                break;
+        }
+        assert(streamed48 == expected48);
+    }
+}
@@ -1,7 +1,7 @@
 // sai - General purpose self-contained C++ libraries.
 //
 // guid.h
-// Wrapper utility for Windows GUIDs.
+// Portable utility for generating, parsing and formatting GUIDs.
 // 
 // MIT License
 // 
@@ -28,10 +28,28 @@
 #ifndef SAI_CORE_GUID_H
 #define SAI_CORE_GUID_H
 
+#include "system_random.h"
+
 #include <string>
+#include <string_view>
+#include <stdexcept>
 #include <cwchar>
-#include <algorithm>
-#include <Windows.h>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <atomic>
+#include <memory>
+#include <system_error>
+#include <chrono>
+#include <functional>
+
+#if !defined(SAI_CORE_NO_SIMD) && defined(__AVX2__)
+#define SAI_CORE_GUID_AVX2
+#include <immintrin.h>
+#elif !defined(SAI_CORE_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define SAI_CORE_GUID_SSE2
+#include <emmintrin.h>
+#endif
 
 #ifndef SAI_CORE_CREATENEW
 #define SAI_CORE_CREATENEW
@@ -46,16 +64,35 @@ constexpr createnew_t createnew;
 
 enum class guid_format
 {
+#ifdef _MSC_VER
     default = 1,
+#endif
     uppercase = 1,
     lowercase = 2,
     uppercase_no_brackets,
     lowercase_no_brackets
 };
 
+enum class guid_version
+{
+    // name based, MD5 hash of a namespace guid and a name
+    v3 = 3,
+    // random
+    v4 = 4,
+    // name based, SHA-1 hash of a namespace guid and a name
+    v5 = 5,
+    // time ordered, unix millisecond timestamp followed by a per thread counter
+    v7 = 7
+};
+
 class guid
 {
 public:
+    // Length of the longest string form, {xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx}
+    static constexpr std::size_t max_string_length = 38;
+
+    using generator_type = guid (*)();
+
     static guid create_new()
     {
         guid g;
@@ -63,7 +100,31 @@ public:
         return g;
     }
 
-    guid()
+    static guid create_new(guid_version version)
+    {
+        guid g;
+        g.create(version);
+        return g;
+    }
+
+    // Parses xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx with optional surrounding brackets and
+    // throws std::invalid_argument if the string is malformed; can be evaluated at
+    // compile time, in which case a malformed string fails to compile
+    static constexpr guid parse(std::string_view str)
+    {
+        guid g;
+        if (!g.parse_constant(str.data(), str.size()))
+            throw std::invalid_argument("Could not parse guid.");
+        return g;
+    }
+
+    constexpr guid()
+    {
+    }
+
+    // Builds a guid from the first and last 8 bytes of its canonical string form,
+    // each read as a big endian integer
+    constexpr guid(std::uint64_t high, std::uint64_t low) : high_(high), low_(low)
     {
     }
 
@@ -72,25 +133,24 @@ public:
         create();
     }
 
-    explicit guid(const char* str) : guid(string_to_wstring(str))
+    guid(createnew_t, guid_version version)
+    {
+        create(version);
+    }
+
+    explicit guid(const char* str)
     {
+        from_chars(str, std::strlen(str));
     }
 
-    explicit guid(const std::string& str) : guid(str.c_str())
+    explicit guid(const std::string& str)
     {
+        from_chars(str.c_str(), str.length());
     }
 
     explicit guid(const wchar_t* str)
     {
-        std::wstring wstr(str);
-        if (wstr.length() > 1)
-        {
-            if (wstr[0] != L'{')
-                wstr.insert(0, L"{");
-            if (wstr[wstr.length() - 1] != L'}')
-                wstr.append(L"}");
-        }
-        CLSIDFromString(wstr.c_str(), &guid_);
+        from_wchars(str, std::wcslen(str));
     }
 
     explicit guid(const std::wstring& str) : guid(str.c_str())
@@ -99,64 +159,119 @@ public:
 
     void swap(guid& other)
     {
-        std::swap(guid_, other.guid_);
+        std::swap(high_, other.high_);
+        std::swap(low_, other.low_);
     }
 
     void create()
     {
-        if (empty())
+        generator_type function = generator_function().load(std::memory_order_acquire);
+        if (function == nullptr)
+        {
+            create(guid_version::v4);
+        }
+        else if (empty())
         {
-            CoCreateGuid(&guid_);
+            *this = function();
         }
     }
 
-    void clear()
+    // Replaces how create(), create_new() and guid(createnew) make guids, for example
+    // with a guid_pool, nullptr restores the default version 4 generator. Calls that
+    // name a version always use the default generators.
+    static void generator(generator_type function)
     {
-        guid_ = {};
+        generator_function().store(function, std::memory_order_release);
     }
 
-    bool empty() const
+    static generator_type generator()
     {
-        return guid_ == GUID_NULL;
+        return generator_function().load(std::memory_order_acquire);
     }
 
-    std::string to_string() const
+    // Makes a random version 4 or a time ordered version 7 guid, throws
+    // std::invalid_argument for the name based versions, see create_from_name
+    void create(guid_version version)
     {
-        return to_string(guid_format::default);
+        if (version != guid_version::v4 && version != guid_version::v7)
+            throw std::invalid_argument("Only version 4 and version 7 guids can be created without a name, use create_from_name for version 3 and version 5.");
+        if (!empty())
+            return;
+        if (version == guid_version::v7)
+        {
+            create_time_ordered();
+            return;
+        }
+        next_random(high_, low_);
+        // RFC 4122 version 4 and variant 1 bits
+        high_ = (high_ & 0xFFFFFFFFFFFF0FFFull) | 0x0000000000004000ull;
+        low_ = (low_ & 0x3FFFFFFFFFFFFFFFull) | 0x8000000000000000ull;
     }
 
-    std::string to_string(guid_format format) const
+    // Name based guids, the same namespace and name always give the same guid.
+    // Version 3 hashes the name with MD5 and version 5 with SHA-1.
+    static guid create_from_name(const guid& name_space, std::string_view name, guid_version version = guid_version::v5)
     {
-        std::string str;
-        str.resize(39);
+        guid g;
+        create_from_names(name_space, &name, 1, &g, version);
+        return g;
+    }
 
-        std::string fmt;
-        switch (format)
+    // Creates count name based guids into result, with SSE2 or AVX2 the SHA-1
+    // digests of version 5 guids are computed for 4 or 8 names at once
+    static void create_from_names(const guid& name_space, const std::string_view* names, std::size_t count, guid* result, guid_version version = guid_version::v5)
+    {
+        if (version != guid_version::v3 && version != guid_version::v5)
+            throw std::invalid_argument("Name based guids are either version 3 or version 5.");
+
+        unsigned char prefix[16];
+        store_big_endian(prefix, name_space.high_);
+        store_big_endian(prefix + 8, name_space.low_);
+
+        if (version == guid_version::v3)
         {
-        case guid_format::uppercase:
-            fmt = "{%08X-%04X-%04X-%02X%02X-%02X%02X%02X%02X%02X%02X}";
-            break;
-        case guid_format::lowercase:
-            fmt = "{%08x-%04x-%04x-%02x%02x-%02x%02x%02x%02x%02x%02x}";
-            break;
-        case guid_format::uppercase_no_brackets:
-            fmt = "%08X-%04X-%04X-%02X%02X-%02X%02X%02X%02X%02X%02X";
-            break;
-        case guid_format::lowercase_no_brackets:
-            fmt = "%08x-%04x-%04x-%02x%02x-%02x%02x%02x%02x%02x%02x";
-            break;
+            for (std::size_t i = 0; i < count; i++)
+                result[i] = md5_name(prefix, names[i]);
+        }
+        else
+        {
+            sha1_names(prefix, names, count, result);
         }
+    }
 
-        snprintf((char*)str.c_str(), str.length(), fmt.c_str(), guid_.Data1, guid_.Data2, guid_.Data3, guid_.Data4[0], guid_.Data4[1], guid_.Data4[2], guid_.Data4[3], guid_.Data4[4], guid_.Data4[5], guid_.Data4[6], guid_.Data4[7]);
+    constexpr std::uint64_t high() const { return high_; }
+    constexpr std::uint64_t low() const { return low_; }
 
-        trim_null_terminator(str);
+    constexpr guid_version version() const
+    {
+        return (guid_version)((high_ >> 12) & 0x0F);
+    }
 
-        return str;
+    void clear()
+    {
+        high_ = 0;
+        low_ = 0;
+    }
+
+    constexpr bool empty() const
+    {
+        return (high_ | low_) == 0;
+    }
+
+    std::string to_string() const
+    {
+        return to_string(guid_format::uppercase);
+    }
+
+    std::string to_string(guid_format format) const
+    {
+        char buffer[max_string_length];
+        return std::string(buffer, to_chars(buffer, format));
     }
 
     std::string to_string(char format) const
     {
-        guid_format fmt = guid_format::default;
+        guid_format fmt = guid_format::uppercase;
         switch (format)
         {
         case 'B':
@@ -182,52 +297,681 @@ public:
 
     std::wstring to_wstring() const
     {
-        return to_wstring(guid_format::default);
+        return to_wstring(guid_format::uppercase);
     }
 
     std::wstring to_wstring(guid_format format) const
     {
-        return string_to_wstring(to_string(format).c_str());
+        char buffer[max_string_length];
+        return std::wstring(buffer, to_chars(buffer, format));
     }
 
     std::wstring to_wstring(char format) const
     {
-        return string_to_wstring(to_string(format).c_str());
+        std::string str = to_string(format);
+        return std::wstring(str.begin(), str.end());
     }
 
     std::wstring to_wstring(const std::string& format) const
     {
-        return string_to_wstring(to_string(format).c_str());
+        std::string str = to_string(format);
+        return std::wstring(str.begin(), str.end());
+    }
+
+    // Writes the guid into buffer without a null terminator, buffer must hold at
+    // least max_string_length characters, returns one past the last character written
+    char* to_chars(char* buffer, guid_format format) const
+    {
+        bool uppercase = format == guid_format::uppercase || format == guid_format::uppercase_no_brackets;
+        bool brackets = format == guid_format::uppercase || format == guid_format::lowercase;
+
+        unsigned char bytes[16];
+        store_big_endian(bytes, high_);
+        store_big_endian(bytes + 8, low_);
+
+        char hex[32];
+        encode_hex(bytes, hex, uppercase);
+
+        char* p = buffer;
+        *p = '{';
+        p += brackets;
+        std::memcpy(p, hex, 8);
+        p[8] = '-';
+        std::memcpy(p + 9, hex + 8, 4);
+        p[13] = '-';
+        std::memcpy(p + 14, hex + 12, 4);
+        p[18] = '-';
+        std::memcpy(p + 19, hex + 16, 4);
+        p[23] = '-';
+        std::memcpy(p + 24, hex + 20, 12);
+        p += 36;
+        *p = '}';
+        return p + brackets;
+    }
+
+    // Parses xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx with optional surrounding brackets,
+    // returns false and leaves the guid unchanged if the string is malformed
+    bool from_chars(const char* str, std::size_t length)
+    {
+        if (length > 0 && str[0] == '{')
+        {
+            str++;
+            length--;
+        }
+        if (length > 0 && str[length - 1] == '}')
+            length--;
+        if (length != 36)
+            return false;
+
+        bool dashes = (str[8] == '-') & (str[13] == '-') & (str[18] == '-') & (str[23] == '-');
+
+        char hex[32];
+        std::memcpy(hex, str, 8);
+        std::memcpy(hex + 8, str + 9, 4);
+        std::memcpy(hex + 12, str + 14, 4);
+        std::memcpy(hex + 16, str + 19, 4);
+        std::memcpy(hex + 20, str + 24, 12);
+
+        unsigned char bytes[16];
+        if (!(decode_hex(hex, bytes) & dashes))
+            return false;
+
+        high_ = load_big_endian(bytes);
+        low_ = load_big_endian(bytes + 8);
+        return true;
     }
 
-    bool operator == (const guid& other) const
+    constexpr bool operator == (const guid& other) const
     {
-        return IsEqualGUID(guid_, other.guid_) == TRUE;
+        return ((high_ ^ other.high_) | (low_ ^ other.low_)) == 0;
     }
 
-    bool operator != (const guid& other) const
+    constexpr bool operator != (const guid& other) const
     {
         return !(*this == other);
     }
 
+    // Guids are ordered as their canonical strings, which for version 7 guids is creation order
+    constexpr bool operator < (const guid& other) const
+    {
+        return (high_ < other.high_) | ((high_ == other.high_) & (low_ < other.low_));
+    }
+
+    constexpr bool operator > (const guid& other) const
+    {
+        return other < *this;
+    }
+
+    constexpr bool operator <= (const guid& other) const
+    {
+        return !(other < *this);
+    }
+
+    constexpr bool operator >= (const guid& other) const
+    {
+        return !(*this < other);
+    }
+
+    constexpr int compare(const guid& other) const
+    {
+        int c = ((high_ > other.high_) - (high_ < other.high_)) * 2 + ((low_ > other.low_) - (low_ < other.low_));
+        return (c > 0) - (c < 0);
+    }
+
+    // The random bits of a guid are already well distributed, the multiplies only
+    // spread the timestamp of version 7 guids over the whole hash
+    constexpr std::size_t hash() const
+    {
+        std::uint64_t h = (high_ * 0x9E3779B97F4A7C15ull) ^ low_;
+        h ^= h >> 32;
+        h *= 0xD6E8FEB86659FD93ull;
+        h ^= h >> 32;
+        return (std::size_t)h;
+    }
+
 private:
-    std::wstring string_to_wstring(const char* str) const
+    // Number of GUIDs worth of entropy requested from the operating system at once
+    static constexpr std::size_t entropy_block_size = 2048;
+
+    static void next_random(std::uint64_t& high, std::uint64_t& low)
     {
-        std::wstring wstr;
-        wstr.resize(39);
-        MultiByteToWideChar(0, 0, str, (int)wstr.length(), (wchar_t*)wstr.c_str(), (int)wstr.length());
-        trim_null_terminator(wstr);
-        return wstr;
+        high = system_random_word<entropy_block_size * 2>();
+        low = system_random_word<entropy_block_size * 2>();
     }
 
-    template <class Type>
-    void trim_null_terminator(std::basic_string<Type>& str) const
+    // Per thread state of the version 7 generator, the counter spans the 12 bits
+    // of rand_a and the top 30 bits of rand_b, the remaining 32 bits are random
+    struct time_order_state
+    {
+        std::uint64_t timestamp = 0;
+        std::uint64_t counter = 0;
+    };
+
+    static constexpr std::uint64_t counter_bits = 42;
+
+    void create_time_ordered()
     {
-        str.erase(std::find_if(str.rbegin(), str.rend(), [](auto ch) { return ch != '\0'; }).base(), str.end());
+        thread_local time_order_state state;
+
+        std::uint64_t random_high;
+        std::uint64_t random_low;
+        next_random(random_high, random_low);
+
+        std::uint64_t now = (std::uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        // A new millisecond reseeds the counter leaving its top bit clear, so there is
+        // room for at least 2^41 increments; if the clock goes backwards or the counter
+        // overflows the timestamp is carried forward to keep the sequence increasing
+        std::uint64_t seed = random_high & ((1ull << (counter_bits - 1)) - 1);
+        if (now > state.timestamp)
+        {
+            state.timestamp = now;
+            state.counter = seed;
+        }
+        else if (++state.counter >> counter_bits)
+        {
+            state.timestamp++;
+            state.counter = seed;
+        }
+
+        high_ = ((state.timestamp & 0xFFFFFFFFFFFFull) << 16) | 0x7000 | (state.counter >> 30);
+        low_ = 0x8000000000000000ull | ((state.counter & ((1ull << 30) - 1)) << 32) | (random_low & 0xFFFFFFFFull);
+    }
+
+    static std::size_t name_block_count(std::size_t name_length)
+    {
+        return (16 + name_length + 8) / 64 + 1;
+    }
+
+    // Writes block index of the padded message made of the namespace bytes followed
+    // by the name, SHA-1 stores the message length big endian and MD5 little endian
+    static void name_block(const unsigned char* prefix, std::string_view name, std::size_t index, unsigned char* block, bool big_endian)
+    {
+        std::size_t total = 16 + name.size();
+        std::size_t begin = index * 64;
+        std::memset(block, 0, 64);
+        if (index == 0)
+            std::memcpy(block, prefix, 16);
+        std::size_t from = begin > 16 ? begin : 16;
+        std::size_t to = begin + 64 < total ? begin + 64 : total;
+        if (from < to)
+            std::memcpy(block + (from - begin), name.data() + (from - 16), to - from);
+        if (total >= begin && total < begin + 64)
+            block[total - begin] = 0x80;
+        if (index == name_block_count(name.size()) - 1)
+        {
+            std::uint64_t bits = (std::uint64_t)total * 8;
+            for (int i = 0; i < 8; i++)
+                block[big_endian ? 63 - i : 56 + i] = (unsigned char)(bits >> (i * 8));
+        }
+    }
+
+    static guid name_guid(std::uint64_t high, std::uint64_t low, unsigned version)
+    {
+        return guid((high & 0xFFFFFFFFFFFF0FFFull) | ((std::uint64_t)version << 12), (low & 0x3FFFFFFFFFFFFFFFull) | 0x8000000000000000ull);
+    }
+
+    static std::uint32_t rotate_left(std::uint32_t value, int count)
+    {
+        return (value << count) | (value >> (32 - count));
+    }
+
+    static guid md5_name(const unsigned char* prefix, std::string_view name)
+    {
+        static const std::uint32_t k[64] = {
+            0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+            0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+            0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+            0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+            0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+            0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+            0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+            0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391 };
+        static const int shifts[16] = { 7, 12, 17, 22, 5, 9, 14, 20, 4, 11, 16, 23, 6, 10, 15, 21 };
+
+        std::uint32_t state[4] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476 };
+        std::size_t blocks = name_block_count(name.size());
+        for (std::size_t b = 0; b < blocks; b++)
+        {
+            unsigned char block[64];
+            name_block(prefix, name, b, block, false);
+            std::uint32_t m[16];
+            for (int i = 0; i < 16; i++)
+                m[i] = (std::uint32_t)block[i * 4] | ((std::uint32_t)block[i * 4 + 1] << 8) | ((std::uint32_t)block[i * 4 + 2] << 16) | ((std::uint32_t)block[i * 4 + 3] << 24);
+
+            std::uint32_t a = state[0], b2 = state[1], c = state[2], d = state[3];
+            for (int i = 0; i < 64; i++)
+            {
+                std::uint32_t f;
+                int g;
+                if (i < 16)
+                {
+                    f = (b2 & c) | (~b2 & d);
+                    g = i;
+                }
+                else if (i < 32)
+                {
+                    f = (d & b2) | (~d & c);
+                    g = (5 * i + 1) & 15;
+                }
+                else if (i < 48)
+                {
+                    f = b2 ^ c ^ d;
+                    g = (3 * i + 5) & 15;
+                }
+                else
+                {
+                    f = c ^ (b2 | ~d);
+                    g = (7 * i) & 15;
+                }
+                std::uint32_t temp = d;
+                d = c;
+                c = b2;
+                b2 = b2 + rotate_left(a + f + k[i] + m[g], shifts[(i / 16) * 4 + (i & 3)]);
+                a = temp;
+            }
+            state[0] += a;
+            state[1] += b2;
+            state[2] += c;
+            state[3] += d;
+        }
+
+        unsigned char digest[16];
+        for (int i = 0; i < 16; i++)
+            digest[i] = (unsigned char)(state[i / 4] >> ((i % 4) * 8));
+        return name_guid(load_big_endian(digest), load_big_endian(digest + 8), 3);
+    }
+
+    static void sha1_compress(std::uint32_t* state, const std::uint32_t* words)
+    {
+        std::uint32_t w[80];
+        for (int i = 0; i < 16; i++)
+            w[i] = words[i];
+        for (int i = 16; i < 80; i++)
+            w[i] = rotate_left(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+        std::uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+        for (int i = 0; i < 80; i++)
+        {
+            std::uint32_t f;
+            std::uint32_t k;
+            if (i < 20)
+            {
+                f = (b & c) | (~b & d);
+                k = 0x5A827999;
+            }
+            else if (i < 40)
+            {
+                f = b ^ c ^ d;
+                k = 0x6ED9EBA1;
+            }
+            else if (i < 60)
+            {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8F1BBCDC;
+            }
+            else
+            {
+                f = b ^ c ^ d;
+                k = 0xCA62C1D6;
+            }
+            std::uint32_t temp = rotate_left(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = rotate_left(b, 30);
+            b = a;
+            a = temp;
+        }
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+    }
+
+    static void sha1_block_words(const unsigned char* prefix, std::string_view name, std::size_t index, std::uint32_t* words)
+    {
+        unsigned char block[64];
+        name_block(prefix, name, index, block, true);
+        for (int i = 0; i < 16; i++)
+            words[i] = ((std::uint32_t)block[i * 4] << 24) | ((std::uint32_t)block[i * 4 + 1] << 16) | ((std::uint32_t)block[i * 4 + 2] << 8) | (std::uint32_t)block[i * 4 + 3];
+    }
+
+    static guid sha1_name(const unsigned char* prefix, std::string_view name)
+    {
+        std::uint32_t state[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+        std::size_t blocks = name_block_count(name.size());
+        for (std::size_t b = 0; b < blocks; b++)
+        {
+            std::uint32_t words[16];
+            sha1_block_words(prefix, name, b, words);
+            sha1_compress(state, words);
+        }
+        return name_guid(((std::uint64_t)state[0] << 32) | state[1], ((std::uint64_t)state[2] << 32) | state[3], 5);
+    }
+
+#if defined(SAI_CORE_GUID_AVX2)
+    using sha1_vector = __m256i;
+    static constexpr std::size_t sha1_lanes = 8;
+    static sha1_vector sha1_set(std::uint32_t value) { return _mm256_set1_epi32((int)value); }
+    static sha1_vector sha1_load(const std::uint32_t* values) { return _mm256_loadu_si256((const __m256i*)values); }
+    static void sha1_store(std::uint32_t* values, sha1_vector v) { _mm256_storeu_si256((__m256i*)values, v); }
+    static sha1_vector sha1_add(sha1_vector a, sha1_vector b) { return _mm256_add_epi32(a, b); }
+    static sha1_vector sha1_xor(sha1_vector a, sha1_vector b) { return _mm256_xor_si256(a, b); }
+    static sha1_vector sha1_and(sha1_vector a, sha1_vector b) { return _mm256_and_si256(a, b); }
+    static sha1_vector sha1_or(sha1_vector a, sha1_vector b) { return _mm256_or_si256(a, b); }
+    static sha1_vector sha1_andnot(sha1_vector a, sha1_vector b) { return _mm256_andnot_si256(a, b); }
+    template <int count>
+    static sha1_vector sha1_rotate(sha1_vector v) { return _mm256_or_si256(_mm256_slli_epi32(v, count), _mm256_srli_epi32(v, 32 - count)); }
+#elif defined(SAI_CORE_GUID_SSE2)
+    using sha1_vector = __m128i;
+    static constexpr std::size_t sha1_lanes = 4;
+    static sha1_vector sha1_set(std::uint32_t value) { return _mm_set1_epi32((int)value); }
+    static sha1_vector sha1_load(const std::uint32_t* values) { return _mm_loadu_si128((const __m128i*)values); }
+    static void sha1_store(std::uint32_t* values, sha1_vector v) { _mm_storeu_si128((__m128i*)values, v); }
+    static sha1_vector sha1_add(sha1_vector a, sha1_vector b) { return _mm_add_epi32(a, b); }
+    static sha1_vector sha1_xor(sha1_vector a, sha1_vector b) { return _mm_xor_si128(a, b); }
+    static sha1_vector sha1_and(sha1_vector a, sha1_vector b) { return _mm_and_si128(a, b); }
+    static sha1_vector sha1_or(sha1_vector a, sha1_vector b) { return _mm_or_si128(a, b); }
+    static sha1_vector sha1_andnot(sha1_vector a, sha1_vector b) { return _mm_andnot_si128(a, b); }
+    template <int count>
+    static sha1_vector sha1_rotate(sha1_vector v) { return _mm_or_si128(_mm_slli_epi32(v, count), _mm_srli_epi32(v, 32 - count)); }
+#endif
+
+#if defined(SAI_CORE_GUID_AVX2) || defined(SAI_CORE_GUID_SSE2)
+    // One SHA-1 compression of a different block in each lane, words[i][lane] is
+    // word i of the block of lane
+    static void sha1_compress_lanes(sha1_vector* state, const std::uint32_t (*words)[sha1_lanes])
+    {
+        sha1_vector w[16];
+        for (int i = 0; i < 16; i++)
+            w[i] = sha1_load(words[i]);
+
+        sha1_vector a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+        for (int i = 0; i < 80; i++)
+        {
+            if (i >= 16)
+                w[i & 15] = sha1_rotate<1>(sha1_xor(sha1_xor(w[(i - 3) & 15], w[(i - 8) & 15]), sha1_xor(w[(i - 14) & 15], w[i & 15])));
+            sha1_vector f;
+            std::uint32_t k;
+            if (i < 20)
+            {
+                f = sha1_or(sha1_and(b, c), sha1_andnot(b, d));
+                k = 0x5A827999;
+            }
+            else if (i < 40)
+            {
+                f = sha1_xor(sha1_xor(b, c), d);
+                k = 0x6ED9EBA1;
+            }
+            else if (i < 60)
+            {
+                f = sha1_or(sha1_and(b, c), sha1_and(d, sha1_or(b, c)));
+                k = 0x8F1BBCDC;
+            }
+            else
+            {
+                f = sha1_xor(sha1_xor(b, c), d);
+                k = 0xCA62C1D6;
+            }
+            sha1_vector temp = sha1_add(sha1_add(sha1_rotate<5>(a), f), sha1_add(sha1_add(e, sha1_set(k)), w[i & 15]));
+            e = d;
+            d = c;
+            c = sha1_rotate<30>(b);
+            b = a;
+            a = temp;
+        }
+        state[0] = sha1_add(state[0], a);
+        state[1] = sha1_add(state[1], b);
+        state[2] = sha1_add(state[2], c);
+        state[3] = sha1_add(state[3], d);
+        state[4] = sha1_add(state[4], e);
+    }
+#endif
+
+    static void sha1_names(const unsigned char* prefix, const std::string_view* names, std::size_t count, guid* result)
+    {
+        std::size_t i = 0;
+#if defined(SAI_CORE_GUID_AVX2) || defined(SAI_CORE_GUID_SSE2)
+        // Lanes whose name needs fewer blocks keep hashing padding after their digest
+        // has been taken, so a batch costs as much as its longest name
+        for (; i + sha1_lanes <= count; i += sha1_lanes)
+        {
+            std::size_t blocks[sha1_lanes];
+            std::size_t max_blocks = 0;
+            for (std::size_t lane = 0; lane < sha1_lanes; lane++)
+            {
+                blocks[lane] = name_block_count(names[i + lane].size());
+                max_blocks = blocks[lane] > max_blocks ? blocks[lane] : max_blocks;
+            }
+
+            sha1_vector state[5] = { sha1_set(0x67452301), sha1_set(0xEFCDAB89), sha1_set(0x98BADCFE), sha1_set(0x10325476), sha1_set(0xC3D2E1F0) };
+            std::uint32_t digests[5][sha1_lanes];
+            for (std::size_t b = 0; b < max_blocks; b++)
+            {
+                std::uint32_t words[16][sha1_lanes];
+                bool finished = false;
+                for (std::size_t lane = 0; lane < sha1_lanes; lane++)
+                {
+                    std::uint32_t lane_words[16] = {};
+                    if (b < blocks[lane])
+                        sha1_block_words(prefix, names[i + lane], b, lane_words);
+                    for (int w = 0; w < 16; w++)
+                        words[w][lane] = lane_words[w];
+                    finished |= b + 1 == blocks[lane];
+                }
+
+                sha1_compress_lanes(state, words);
+
+                if (finished)
+                {
+                    std::uint32_t values[5][sha1_lanes];
+                    for (int w = 0; w < 5; w++)
+                        sha1_store(values[w], state[w]);
+                    for (std::size_t lane = 0; lane < sha1_lanes; lane++)
+                    {
+                        if (b + 1 == blocks[lane])
+                        {
+                            for (int w = 0; w < 5; w++)
+                                digests[w][lane] = values[w][lane];
+                        }
+                    }
+                }
+            }
+
+            for (std::size_t lane = 0; lane < sha1_lanes; lane++)
+                result[i + lane] = name_guid(((std::uint64_t)digests[0][lane] << 32) | digests[1][lane], ((std::uint64_t)digests[2][lane] << 32) | digests[3][lane], 5);
+        }
+#endif
+        for (; i < count; i++)
+            result[i] = sha1_name(prefix, names[i]);
+    }
+
+    static std::atomic<generator_type>& generator_function()
+    {
+        static std::atomic<generator_type> function(nullptr);
+        return function;
+    }
+
+    bool from_wchars(const wchar_t* str, std::size_t length)
+    {
+        if (length > max_string_length)
+            return false;
+        char buffer[max_string_length];
+        for (std::size_t i = 0; i < length; i++)
+            buffer[i] = (str[i] > 0 && str[i] < 0x80) ? (char)str[i] : '?';
+        return from_chars(buffer, length);
+    }
+
+    static std::uint64_t load_big_endian(const unsigned char* bytes)
+    {
+        std::uint64_t value = 0;
+        for (int i = 0; i < 8; i++)
+            value = (value << 8) | bytes[i];
+        return value;
+    }
+
+    static void store_big_endian(unsigned char* bytes, std::uint64_t value)
+    {
+        for (int i = 7; i >= 0; i--)
+        {
+            bytes[i] = (unsigned char)value;
+            value >>= 8;
+        }
+    }
+
+    // Encodes 16 bytes into 32 hex digits
+    static void encode_hex(const unsigned char* bytes, char* hex, bool uppercase)
+    {
+#if defined(SAI_CORE_GUID_AVX2)
+        // Widen each byte to 16 bits and split it into its two nibbles, high nibble first
+        __m256i wide = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)bytes));
+        __m256i nibbles = _mm256_or_si256(_mm256_srli_epi16(wide, 4), _mm256_slli_epi16(_mm256_and_si256(wide, _mm256_set1_epi16(0x0F)), 8));
+        __m256i letters = _mm256_and_si256(_mm256_cmpgt_epi8(nibbles, _mm256_set1_epi8(9)), _mm256_set1_epi8(uppercase ? 'A' - '0' - 10 : 'a' - '0' - 10));
+        __m256i digits = _mm256_add_epi8(_mm256_add_epi8(nibbles, _mm256_set1_epi8('0')), letters);
+        _mm256_storeu_si256((__m256i*)hex, digits);
+#elif defined(SAI_CORE_GUID_SSE2)
+        __m128i in = _mm_loadu_si128((const __m128i*)bytes);
+        __m128i mask = _mm_set1_epi8(0x0F);
+        __m128i high = _mm_and_si128(_mm_srli_epi16(in, 4), mask);
+        __m128i low = _mm_and_si128(in, mask);
+        __m128i nine = _mm_set1_epi8(9);
+        __m128i zero = _mm_set1_epi8('0');
+        __m128i adjust = _mm_set1_epi8(uppercase ? 'A' - '0' - 10 : 'a' - '0' - 10);
+        __m128i first = _mm_unpacklo_epi8(high, low);
+        __m128i second = _mm_unpackhi_epi8(high, low);
+        first = _mm_add_epi8(_mm_add_epi8(first, zero), _mm_and_si128(_mm_cmpgt_epi8(first, nine), adjust));
+        second = _mm_add_epi8(_mm_add_epi8(second, zero), _mm_and_si128(_mm_cmpgt_epi8(second, nine), adjust));
+        _mm_storeu_si128((__m128i*)hex, first);
+        _mm_storeu_si128((__m128i*)(hex + 16), second);
+#else
+        const char* digits = uppercase ? "0123456789ABCDEF" : "0123456789abcdef";
+        for (int i = 0; i < 16; i++)
+        {
+            hex[i * 2] = digits[bytes[i] >> 4];
+            hex[i * 2 + 1] = digits[bytes[i] & 0x0F];
+        }
+#endif
+    }
+
+    // Decodes 32 hex digits into 16 bytes, returns false if any character is not a hex digit
+    static bool decode_hex(const char* hex, unsigned char* bytes)
+    {
+#if defined(SAI_CORE_GUID_AVX2)
+        __m256i in = _mm256_loadu_si256((const __m256i*)hex);
+        __m256i digit = _mm256_sub_epi8(in, _mm256_set1_epi8('0'));
+        __m256i is_digit = _mm256_cmpeq_epi8(_mm256_max_epu8(digit, _mm256_set1_epi8(9)), _mm256_set1_epi8(9));
+        __m256i letter = _mm256_sub_epi8(_mm256_or_si256(in, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+        __m256i is_letter = _mm256_cmpeq_epi8(_mm256_max_epu8(letter, _mm256_set1_epi8(5)), _mm256_set1_epi8(5));
+        if ((unsigned)_mm256_movemask_epi8(_mm256_or_si256(is_digit, is_letter)) != 0xFFFFFFFFu)
+            return false;
+        __m256i values = _mm256_or_si256(_mm256_and_si256(digit, is_digit), _mm256_and_si256(_mm256_add_epi8(letter, _mm256_set1_epi8(10)), is_letter));
+        // Each 16 bit lane holds the high nibble in its low byte and the low nibble in its high byte
+        __m256i combined = _mm256_or_si256(_mm256_slli_epi16(_mm256_and_si256(values, _mm256_set1_epi16(0x00FF)), 4), _mm256_srli_epi16(values, 8));
+        _mm_storeu_si128((__m128i*)bytes, _mm_packus_epi16(_mm256_castsi256_si128(combined), _mm256_extracti128_si256(combined, 1)));
+        return true;
+#elif defined(SAI_CORE_GUID_SSE2)
+        __m128i combined[2];
+        int valid = 0xFFFF;
+        for (int i = 0; i < 2; i++)
+        {
+            __m128i in = _mm_loadu_si128((const __m128i*)(hex + i * 16));
+            __m128i digit = _mm_sub_epi8(in, _mm_set1_epi8('0'));
+            __m128i is_digit = _mm_cmpeq_epi8(_mm_max_epu8(digit, _mm_set1_epi8(9)), _mm_set1_epi8(9));
+            __m128i letter = _mm_sub_epi8(_mm_or_si128(in, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+            __m128i is_letter = _mm_cmpeq_epi8(_mm_max_epu8(letter, _mm_set1_epi8(5)), _mm_set1_epi8(5));
+            valid &= _mm_movemask_epi8(_mm_or_si128(is_digit, is_letter));
+            __m128i values = _mm_or_si128(_mm_and_si128(digit, is_digit), _mm_and_si128(_mm_add_epi8(letter, _mm_set1_epi8(10)), is_letter));
+            combined[i] = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(values, _mm_set1_epi16(0x00FF)), 4), _mm_srli_epi16(values, 8));
+        }
+        if (valid != 0xFFFF)
+            return false;
+        _mm_storeu_si128((__m128i*)bytes, _mm_packus_epi16(combined[0], combined[1]));
+        return true;
+#else
+        unsigned char invalid = 0;
+        for (int i = 0; i < 16; i++)
+        {
+            unsigned char high = hex_value(hex[i * 2]);
+            unsigned char low = hex_value(hex[i * 2 + 1]);
+            invalid |= (high | low) & 0x10;
+            bytes[i] = (unsigned char)((high << 4) | (low & 0x0F));
+        }
+        return invalid == 0;
+#endif
+    }
+
+    // Scalar equivalent of from_chars usable in constant expressions
+    constexpr bool parse_constant(const char* str, std::size_t length)
+    {
+        if (length > 0 && str[0] == '{')
+        {
+            str++;
+            length--;
+        }
+        if (length > 0 && str[length - 1] == '}')
+            length--;
+        if (length != 36)
+            return false;
+
+        std::uint64_t halves[2] = {};
+        int nibbles = 0;
+        for (std::size_t i = 0; i < length; i++)
+        {
+            if (i == 8 || i == 13 || i == 18 || i == 23)
+            {
+                if (str[i] != '-')
+                    return false;
+                continue;
+            }
+            unsigned char value = hex_value(str[i]);
+            if (value > 0x0F)
+                return false;
+            halves[nibbles / 16] = (halves[nibbles / 16] << 4) | value;
+            nibbles++;
+        }
+
+        high_ = halves[0];
+        low_ = halves[1];
+        return true;
+    }
+
+    // Returns the value of a hex digit, or 0x10 if the character is not one
+    static constexpr unsigned char hex_value(char ch)
+    {
+        unsigned char digit = (unsigned char)(ch - '0');
+        unsigned char letter = (unsigned char)((ch | 0x20) - 'a');
+        return digit < 10 ? digit : (letter < 6 ? (unsigned char)(letter + 10) : 0x10);
     }
 
 private:
-    GUID guid_ = {};
+    // Stored as two big endian halves, high_ holds the first 8 bytes of the
+    // canonical string form and low_ the last 8
+    std::uint64_t high_ = 0;
+    std::uint64_t low_ = 0;
 };
 
-#endif
\ No newline at end of file
+// Guid literal parsed at compile time, "2ac3e955-939f-4756-8bc1-940bb7c882c3"_guid
+constexpr guid operator""_guid(const char* str, std::size_t length)
+{
+    return guid::parse(std::string_view(str, length));
+}
+
+// Namespaces for name based guids defined by RFC 4122
+constexpr guid guid_namespace_dns = "6ba7b810-9dad-11d1-80b4-00c04fd430c8"_guid;
+constexpr guid guid_namespace_url = "6ba7b811-9dad-11d1-80b4-00c04fd430c8"_guid;
+constexpr guid guid_namespace_oid = "6ba7b812-9dad-11d1-80b4-00c04fd430c8"_guid;
+constexpr guid guid_namespace_x500 = "6ba7b814-9dad-11d1-80b4-00c04fd430c8"_guid;
+
+namespace std
+{
+    template <>
+    struct hash<guid>
+    {
+        std::size_t operator()(const guid& g) const noexcept
+        {
+            return g.hash();
+        }
+    };
+}
+
+#endif
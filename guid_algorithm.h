@@ -0,0 +1,383 @@
+// sai - General purpose self-contained C++ libraries.
+//
+// guid_algorithm.h
+// Bulk algorithms over large arrays of GUIDs.
+// 
+// MIT License
+// 
+// Copyright (c) 2017 Ion Todirel
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef SAI_CORE_GUID_ALGORITHM_H
+#define SAI_CORE_GUID_ALGORITHM_H
+
+#include "guid.h"
+#include "parallel_run.h"
+
+#include <cstddef>
+#include <cstring>
+#include <string_view>
+#include <vector>
+#include <stdexcept>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+#if !defined(SAI_CORE_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define SAI_CORE_GUID_ALGORITHM_SSE2
+#include <emmintrin.h>
+#endif
+
+struct guid_parse_error
+{
+    // Zero based index of the malformed row
+    std::size_t row = 0;
+    // Offset of the first character of the row in the parsed text
+    std::size_t offset = 0;
+};
+
+// Inputs smaller than this are parsed on the calling thread
+constexpr std::size_t guid_parse_chunk_size = 1 << 20;
+
+// Returns the number of rows in text, rows are separated by delimiter and a
+// trailing delimiter does not start a new row
+inline std::size_t count_guid_rows(std::string_view text, char delimiter = '\n')
+{
+    const char* p = text.data();
+    const char* end = p + text.size();
+    std::size_t count = 0;
+#if defined(SAI_CORE_GUID_ALGORITHM_SSE2)
+    __m128i needle = _mm_set1_epi8(delimiter);
+    while (end - p >= 16)
+    {
+        // Byte counters in acc can take at most 255 matches before being summed
+        __m128i acc = _mm_setzero_si128();
+        for (int i = 0; i < 255 && end - p >= 16; i++, p += 16)
+            acc = _mm_sub_epi8(acc, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)p), needle));
+        __m128i sum = _mm_sad_epu8(acc, _mm_setzero_si128());
+        count += (std::size_t)_mm_cvtsi128_si32(sum) + (std::size_t)_mm_cvtsi128_si32(_mm_srli_si128(sum, 8));
+    }
+#endif
+    for (; p < end; p++)
+        count += *p == delimiter;
+    if (!text.empty() && text.back() != delimiter)
+        count++;
+    return count;
+}
+
+// Parses rows [first, last) of text starting at row index row, into output
+inline void parse_guid_rows(const char* first, const char* last, char delimiter, std::size_t base_offset, std::size_t row, guid* output, std::vector<guid_parse_error>& errors)
+{
+    const char* p = first;
+    while (p < last)
+    {
+        const char* row_end;
+        // Most rows are a bare 36 character guid, skip the delimiter search for those
+        if (last - p > 36 && p[36] == delimiter)
+            row_end = p + 36;
+        else
+        {
+            row_end = (const char*)std::memchr(p, delimiter, (std::size_t)(last - p));
+            if (row_end == nullptr)
+                row_end = last;
+        }
+
+        const char* begin = p;
+        const char* end = row_end;
+        while (begin < end && (*begin == ' ' || *begin == '\t'))
+            begin++;
+        while (end > begin && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r'))
+            end--;
+
+        guid g;
+        if (!g.from_chars(begin, (std::size_t)(end - begin)))
+            errors.push_back({ row, base_offset + (std::size_t)(p - first) });
+        output[row] = g;
+
+        row++;
+        p = row_end + 1;
+    }
+}
+
+// Parses text made of one guid per row into output, which must hold count_guid_rows
+// elements. Rows may be surrounded by spaces or tabs, and may end with \r. Malformed
+// rows are left as empty guids in output and reported in errors, in row order. The
+// text is split across thread_count threads, or one per core if thread_count is 0.
+// Returns the number of rows.
+inline std::size_t parse_guids(std::string_view text, guid* output, std::size_t capacity, std::vector<guid_parse_error>& errors, char delimiter = '\n', unsigned thread_count = 0)
+{
+    errors.clear();
+
+    thread_count = parallel_thread_count(thread_count);
+    std::size_t max_chunks = text.size() / guid_parse_chunk_size + 1;
+    std::size_t chunk_count = thread_count < max_chunks ? thread_count : max_chunks;
+
+    // Chunk boundaries are moved past the next delimiter so no row is split
+    std::vector<std::size_t> bounds(chunk_count + 1, text.size());
+    bounds[0] = 0;
+    for (std::size_t i = 1; i < chunk_count; i++)
+    {
+        std::size_t bound = text.size() / chunk_count * i;
+        if (bound < bounds[i - 1])
+            bound = bounds[i - 1];
+        std::size_t next = text.find(delimiter, bound);
+        bounds[i] = next == std::string_view::npos ? text.size() : next + 1;
+    }
+
+    std::vector<std::size_t> rows(chunk_count + 1, 0);
+    std::vector<std::vector<guid_parse_error>> chunk_errors(chunk_count);
+
+    parallel_run(chunk_count, [&](std::size_t i) { rows[i + 1] = count_guid_rows(text.substr(bounds[i], bounds[i + 1] - bounds[i]), delimiter); });
+    for (std::size_t i = 0; i < chunk_count; i++)
+        rows[i + 1] += rows[i];
+
+    std::size_t total = rows[chunk_count];
+    if (total > capacity)
+        throw std::length_error("The output buffer is too small for the parsed guids.");
+
+    parallel_run(chunk_count, [&](std::size_t i) { parse_guid_rows(text.data() + bounds[i], text.data() + bounds[i + 1], delimiter, bounds[i], rows[i], output, chunk_errors[i]); });
+    for (std::vector<guid_parse_error>& chunk : chunk_errors)
+        errors.insert(errors.end(), chunk.begin(), chunk.end());
+
+    return total;
+}
+
+// Parses text made of one guid per row into guids, returns false if any row is malformed
+inline bool parse_guids(std::string_view text, std::vector<guid>& guids, std::vector<guid_parse_error>& errors, char delimiter = '\n', unsigned thread_count = 0)
+{
+    guids.resize(count_guid_rows(text, delimiter));
+    parse_guids(text, guids.data(), guids.size(), errors, delimiter, thread_count);
+    return errors.empty();
+}
+
+// Byte index of the canonical string form used as a radix sort digit, 0 is the most significant
+inline unsigned guid_digit(const guid& g, unsigned digit)
+{
+    return digit < 8 ? (unsigned)(g.high() >> (56 - digit * 8)) & 0xFF : (unsigned)(g.low() >> (120 - digit * 8)) & 0xFF;
+}
+
+// Buckets at or below this size are finished with a comparison sort
+constexpr std::size_t guid_sort_cutoff = 64;
+
+// Most significant digit radix sort of the n guids in from, starting at digit. The guids
+// are scattered into other on each level, leaving the result in other if to_other is true
+// and in from otherwise. Digits shared by the whole bucket, like the timestamp bytes of
+// version 7 guids created close together, are skipped without moving data.
+inline void radix_sort_guids(guid* from, guid* other, std::size_t n, unsigned digit, bool to_other)
+{
+    while (n > guid_sort_cutoff && digit < 16)
+    {
+        std::size_t counts[256] = {};
+        for (std::size_t i = 0; i < n; i++)
+            counts[guid_digit(from[i], digit)]++;
+        if (counts[guid_digit(from[0], digit)] != n)
+        {
+            std::size_t offsets[256];
+            std::size_t offset = 0;
+            for (unsigned b = 0; b < 256; b++)
+            {
+                offsets[b] = offset;
+                offset += counts[b];
+            }
+            for (std::size_t i = 0; i < n; i++)
+                other[offsets[guid_digit(from[i], digit)]++] = from[i];
+            offset = 0;
+            for (unsigned b = 0; b < 256; b++)
+            {
+                radix_sort_guids(other + offset, from + offset, counts[b], digit + 1, !to_other);
+                offset += counts[b];
+            }
+            return;
+        }
+        digit++;
+    }
+
+    std::sort(from, from + n);
+    if (to_other)
+        std::copy(from, from + n, other);
+}
+
+// Sorts [first, last) with a radix sort, allocating a scratch buffer of the same size
+inline void sort_guids(guid* first, guid* last)
+{
+    std::size_t n = (std::size_t)(last - first);
+    if (n <= guid_sort_cutoff)
+    {
+        std::sort(first, last);
+        return;
+    }
+    std::unique_ptr<guid[]> scratch(new guid[n]);
+    radix_sort_guids(first, scratch.get(), n, 0, false);
+}
+
+// Sorts [first, last) on thread_count threads, or one per core if thread_count is 0.
+// The guids are partitioned on their first distinct byte in parallel, then the
+// buckets are radix sorted independently.
+inline void parallel_sort_guids(guid* first, guid* last, unsigned thread_count = 0)
+{
+    std::size_t n = (std::size_t)(last - first);
+    thread_count = parallel_thread_count(thread_count);
+    if (thread_count <= 1 || n < (std::size_t)thread_count * 65536)
+    {
+        sort_guids(first, last);
+        return;
+    }
+
+    std::unique_ptr<guid[]> scratch(new guid[n]);
+    guid* other = scratch.get();
+    std::size_t slice = (n + thread_count - 1) / thread_count;
+
+    // Bits that differ from the first guid anywhere in the input, the leading zero bytes
+    // of the difference are shared by every guid and skipped
+    std::vector<std::uint64_t> high_diff(thread_count, 0);
+    std::vector<std::uint64_t> low_diff(thread_count, 0);
+    parallel_run(thread_count, [&](unsigned t)
+    {
+        std::size_t begin = std::min(n, t * slice);
+        std::size_t end = std::min(n, begin + slice);
+        for (std::size_t i = begin; i < end; i++)
+        {
+            high_diff[t] |= first[i].high() ^ first[0].high();
+            low_diff[t] |= first[i].low() ^ first[0].low();
+        }
+    });
+    std::uint64_t high = 0;
+    std::uint64_t low = 0;
+    for (unsigned t = 0; t < thread_count; t++)
+    {
+        high |= high_diff[t];
+        low |= low_diff[t];
+    }
+    if ((high | low) == 0)
+        return;
+    unsigned digit = 0;
+    while (digit < 16 && ((digit < 8 ? high >> (56 - digit * 8) : low >> (120 - digit * 8)) & 0xFF) == 0)
+        digit++;
+
+    std::vector<std::size_t> counts((std::size_t)thread_count * 256, 0);
+    parallel_run(thread_count, [&](unsigned t)
+    {
+        std::size_t begin = std::min(n, t * slice);
+        std::size_t end = std::min(n, begin + slice);
+        std::size_t* count = counts.data() + t * 256;
+        for (std::size_t i = begin; i < end; i++)
+            count[guid_digit(first[i], digit)]++;
+    });
+
+    // Each thread scatters its slice into the part of every bucket reserved for it
+    std::vector<std::size_t> offsets((std::size_t)thread_count * 256);
+    std::size_t bucket_starts[257];
+    std::size_t offset = 0;
+    for (unsigned b = 0; b < 256; b++)
+    {
+        bucket_starts[b] = offset;
+        for (unsigned t = 0; t < thread_count; t++)
+        {
+            offsets[t * 256 + b] = offset;
+            offset += counts[t * 256 + b];
+        }
+    }
+    bucket_starts[256] = n;
+
+    parallel_run(thread_count, [&](unsigned t)
+    {
+        std::size_t begin = std::min(n, t * slice);
+        std::size_t end = std::min(n, begin + slice);
+        std::size_t* offset = offsets.data() + t * 256;
+        for (std::size_t i = begin; i < end; i++)
+            other[offset[guid_digit(first[i], digit)]++] = first[i];
+    });
+
+    std::atomic<unsigned> next_bucket(0);
+    parallel_run(thread_count, [&](unsigned)
+    {
+        for (unsigned b = next_bucket++; b < 256; b = next_bucket++)
+        {
+            std::size_t begin = bucket_starts[b];
+            radix_sort_guids(other + begin, first + begin, bucket_starts[b + 1] - begin, digit + 1, true);
+        }
+    });
+}
+
+// Removes consecutive duplicates from [first, last), returns the new end of the range
+inline guid* unique_guids(guid* first, guid* last)
+{
+    if (first == last)
+        return last;
+    guid* out = first + 1;
+    for (guid* p = first + 1; p != last; p++)
+    {
+        guid value = *p;
+        *out = value;
+        out += value != out[-1];
+    }
+    return out;
+}
+
+// Returns the first guid in the sorted range [first, last) not less than value
+inline const guid* lower_bound_guids(const guid* first, const guid* last, const guid& value)
+{
+    // Branchless bisection, the compiler turns the step into a conditional move
+    std::size_t n = (std::size_t)(last - first);
+    const guid* base = first;
+    while (n > 1)
+    {
+        std::size_t half = n / 2;
+        base = base[half - 1] < value ? base + half : base;
+        n -= half;
+    }
+    return base + (n == 1 && *base < value);
+}
+
+// Returns the guid equal to value in the sorted range [first, last), or last if there is none
+inline const guid* find_sorted_guids(const guid* first, const guid* last, const guid& value)
+{
+    // Bisect down to a window of 8 guids, then compare the whole window at once
+    std::size_t n = (std::size_t)(last - first);
+    const guid* base = first;
+    while (n > 8)
+    {
+        std::size_t half = n / 2;
+        base = base[half - 1] < value ? base + half : base;
+        n -= half;
+    }
+#if defined(SAI_CORE_GUID_ALGORITHM_SSE2)
+    __m128i needle = _mm_loadu_si128((const __m128i*)&value);
+    for (std::size_t i = 0; i < n; i++)
+    {
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(base + i)), needle)) == 0xFFFF)
+            return base + i;
+    }
+#else
+    for (std::size_t i = 0; i < n; i++)
+    {
+        if (base[i] == value)
+            return base + i;
+    }
+#endif
+    return last;
+}
+
+inline bool contains_sorted_guids(const guid* first, const guid* last, const guid& value)
+{
+    return find_sorted_guids(first, last, value) != last;
+}
+
+#endif
@@ -0,0 +1,477 @@
+// sai - General purpose self-contained C++ libraries.
+//
+// guid_column.h
+// Compact sorted GUID columns stored as binary files.
+// 
+// MIT License
+// 
+// Copyright (c) 2017 Ion Todirel
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef SAI_CORE_GUID_COLUMN_H
+#define SAI_CORE_GUID_COLUMN_H
+
+#include "guid.h"
+#include "mapped_file.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#if !defined(SAI_CORE_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define SAI_CORE_GUID_COLUMN_SSE2
+#include <emmintrin.h>
+#endif
+
+enum class guid_column_compression
+{
+    // raw 16 byte records
+    none = 0,
+    // records are grouped in blocks, each block stores the bytes shared by all its
+    // guids once, which suits time ordered guids whose timestamps repeat
+    prefix = 1
+};
+
+// A sorted column of guids stored in a file and queried through a read-only memory
+// mapping, without deserializing it.
+//
+// The file starts with a 32 byte header: the "SAIGUIDC" magic, the format version,
+// the compression, the number of guids and the block size, all little endian. Guids
+// are stored as the 16 bytes of their canonical string form. Uncompressed columns
+// follow with one record per guid. Prefix compressed columns follow with a directory
+// of 32 byte entries, one per block, holding the block's first guid, the offset of
+// its records and the length of the prefix shared by the block, then the records,
+// each reduced to the bytes after the prefix.
+class guid_column
+{
+public:
+    static constexpr std::size_t block_size = 256;
+
+    // Writes the sorted range [first, last) to path, throws std::invalid_argument if
+    // the range is not sorted
+    static void write(const std::string& path, const guid* first, const guid* last, guid_column_compression compression = guid_column_compression::none)
+    {
+        std::size_t count = (std::size_t)(last - first);
+        for (std::size_t i = 1; i < count; i++)
+        {
+            if (first[i] < first[i - 1])
+                throw std::invalid_argument("The guids written to a column must be sorted.");
+        }
+
+        std::vector<unsigned char> data(header_size);
+        std::memcpy(data.data(), "SAIGUIDC", 8);
+        store_little_endian(data.data() + 8, format_version, 4);
+        store_little_endian(data.data() + 12, (std::uint64_t)compression, 4);
+        store_little_endian(data.data() + 16, count, 8);
+        store_little_endian(data.data() + 24, block_size, 4);
+
+        if (compression == guid_column_compression::none)
+        {
+            data.resize(header_size + count * 16);
+            for (std::size_t i = 0; i < count; i++)
+                store_guid(data.data() + header_size + i * 16, first[i]);
+        }
+        else
+        {
+            std::size_t blocks = (count + block_size - 1) / block_size;
+            std::size_t directory = header_size;
+            std::size_t records = directory + blocks * directory_entry_size;
+            data.resize(records);
+            for (std::size_t b = 0; b < blocks; b++)
+            {
+                const guid* block = first + b * block_size;
+                std::size_t n = count - b * block_size < block_size ? count - b * block_size : block_size;
+
+                unsigned char head[16];
+                unsigned char tail[16];
+                store_guid(head, block[0]);
+                store_guid(tail, block[n - 1]);
+                std::size_t prefix = 0;
+                while (prefix < 15 && head[prefix] == tail[prefix])
+                    prefix++;
+
+                unsigned char* entry = data.data() + directory + b * directory_entry_size;
+                std::memcpy(entry, head, 16);
+                store_little_endian(entry + 16, data.size() - records, 8);
+                entry[24] = (unsigned char)prefix;
+
+                std::size_t offset = data.size();
+                data.resize(offset + n * (16 - prefix));
+                for (std::size_t i = 0; i < n; i++)
+                {
+                    unsigned char bytes[16];
+                    store_guid(bytes, block[i]);
+                    std::memcpy(data.data() + offset + i * (16 - prefix), bytes + prefix, 16 - prefix);
+                }
+            }
+        }
+        // Padding lets queries load whole 16 byte vectors at the end of the records
+        data.resize(data.size() + 16);
+
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write((const char*)data.data(), (std::streamsize)data.size());
+        if (!file)
+            throw std::runtime_error("Could not write " + path + ".");
+    }
+
+    guid_column() {}
+
+    explicit guid_column(const std::string& path)
+    {
+        open(path);
+    }
+
+    void open(const std::string& path)
+    {
+        close();
+        // Queries bisect the column, read ahead would mostly fetch pages they skip
+        file_.open(path, mapped_file_access::random);
+        const unsigned char* data = (const unsigned char*)file_.data();
+        if (file_.size() < header_size + 16 || std::memcmp(data, "SAIGUIDC", 8) != 0 || load_little_endian(data + 8, 4) != format_version)
+        {
+            close();
+            throw std::runtime_error(path + " is not a guid column.");
+        }
+
+        compression_ = (guid_column_compression)load_little_endian(data + 12, 4);
+        count_ = (std::size_t)load_little_endian(data + 16, 8);
+        block_size_ = (std::size_t)load_little_endian(data + 24, 4);
+
+        // The counts and offsets come from the file, they are checked against its size
+        // before use so that a truncated or corrupt file is rejected instead of read past
+        // the mapping. The last 16 bytes are the padding behind the records.
+        bool valid = false;
+        std::size_t available = file_.size() - header_size - 16;
+        if (compression_ == guid_column_compression::none)
+        {
+            records_ = data + header_size;
+            valid = count_ <= available / 16;
+        }
+        else if (compression_ == guid_column_compression::prefix && block_size_ > 0 && count_ <= available)
+        {
+            // Every record takes at least one byte, so count_ is small enough to round up
+            blocks_ = (count_ + block_size_ - 1) / block_size_;
+            directory_ = data + header_size;
+            if (blocks_ <= available / directory_entry_size)
+            {
+                records_ = directory_ + blocks_ * directory_entry_size;
+                valid = valid_blocks(available - blocks_ * directory_entry_size);
+            }
+        }
+        if (!valid)
+        {
+            close();
+            throw std::runtime_error(path + " is not a guid column.");
+        }
+    }
+
+    void close()
+    {
+        file_.close();
+        records_ = nullptr;
+        directory_ = nullptr;
+        count_ = 0;
+        blocks_ = 0;
+        block_size_ = block_size;
+        compression_ = guid_column_compression::none;
+    }
+
+    bool is_open() const { return file_.is_open(); }
+    std::size_t size() const { return count_; }
+    bool empty() const { return count_ == 0; }
+    guid_column_compression compression() const { return compression_; }
+
+    guid operator[](std::size_t index) const
+    {
+        unsigned char bytes[16];
+        if (compression_ == guid_column_compression::none)
+        {
+            std::memcpy(bytes, records_ + index * 16, 16);
+        }
+        else
+        {
+            const unsigned char* entry = directory_ + index / block_size_ * directory_entry_size;
+            std::size_t prefix = entry[24];
+            std::memcpy(bytes, entry, prefix);
+            std::memcpy(bytes + prefix, records_ + load_little_endian(entry + 16, 8) + index % block_size_ * (16 - prefix), 16 - prefix);
+        }
+        return load_guid(bytes);
+    }
+
+    // Index of the first guid not less than value
+    std::size_t lower_bound(const guid& value) const
+    {
+        unsigned char bytes[16];
+        store_guid(bytes, value);
+        return bound(bytes, false);
+    }
+
+    // Index of the first guid greater than value
+    std::size_t upper_bound(const guid& value) const
+    {
+        unsigned char bytes[16];
+        store_guid(bytes, value);
+        return bound(bytes, true);
+    }
+
+    // Indices [first, last) of the guids between low and high, inclusive
+    std::pair<std::size_t, std::size_t> range(const guid& low, const guid& high) const
+    {
+        std::size_t first = lower_bound(low);
+        std::size_t last = upper_bound(high);
+        return { first, last < first ? first : last };
+    }
+
+    bool contains(const guid& value) const
+    {
+        unsigned char bytes[16];
+        store_guid(bytes, value);
+
+        if (compression_ == guid_column_compression::none)
+        {
+            // Bisect down to a window of 8 records, then compare the whole window at once
+            const unsigned char* base = records_;
+            std::size_t n = count_;
+            while (n > 8)
+            {
+                std::size_t half = n / 2;
+                base = std::memcmp(base + (half - 1) * 16, bytes, 16) < 0 ? base + half * 16 : base;
+                n -= half;
+            }
+            return match_window(base, 16, n, bytes, 16);
+        }
+
+        if (blocks_ == 0)
+            return false;
+        std::size_t block = find_block(bytes, 1);
+        const unsigned char* entry = directory_ + block * directory_entry_size;
+        std::size_t prefix = entry[24];
+        if (std::memcmp(entry, bytes, prefix) != 0)
+            return false;
+        std::size_t stride = 16 - prefix;
+        const unsigned char* base = records_ + load_little_endian(entry + 16, 8);
+        std::size_t n = block_count(block);
+        while (n > 8)
+        {
+            std::size_t half = n / 2;
+            base = std::memcmp(base + (half - 1) * stride, bytes + prefix, stride) < 0 ? base + half * stride : base;
+            n -= half;
+        }
+        return match_window(base, stride, n, bytes + prefix, stride);
+    }
+
+private:
+    static constexpr std::size_t header_size = 32;
+    static constexpr std::size_t directory_entry_size = 32;
+    static constexpr std::uint64_t format_version = 1;
+
+    static void store_little_endian(unsigned char* bytes, std::uint64_t value, int size)
+    {
+        for (int i = 0; i < size; i++)
+            bytes[i] = (unsigned char)(value >> (i * 8));
+    }
+
+    static std::uint64_t load_little_endian(const unsigned char* bytes, int size)
+    {
+        std::uint64_t value = 0;
+        for (int i = size - 1; i >= 0; i--)
+            value = (value << 8) | bytes[i];
+        return value;
+    }
+
+    static void store_guid(unsigned char* bytes, const guid& g)
+    {
+        for (int i = 0; i < 8; i++)
+        {
+            bytes[i] = (unsigned char)(g.high() >> (56 - i * 8));
+            bytes[8 + i] = (unsigned char)(g.low() >> (56 - i * 8));
+        }
+    }
+
+    static guid load_guid(const unsigned char* bytes)
+    {
+        std::uint64_t high = 0;
+        std::uint64_t low = 0;
+        for (int i = 0; i < 8; i++)
+        {
+            high = (high << 8) | bytes[i];
+            low = (low << 8) | bytes[8 + i];
+        }
+        return guid(high, low);
+    }
+
+    // True if one of the n records of length bytes starting at base, stride bytes apart, equals value
+    static bool match_window(const unsigned char* base, std::size_t stride, std::size_t n, const unsigned char* value, std::size_t length)
+    {
+#if defined(SAI_CORE_GUID_COLUMN_SSE2)
+        // Records are followed by at least 16 bytes of the file, so whole vectors can
+        // be loaded and the bytes past the record masked out
+        unsigned char padded[16] = {};
+        std::memcpy(padded, value, length);
+        __m128i needle = _mm_loadu_si128((const __m128i*)padded);
+        int mask = (int)((1u << length) - 1);
+        for (std::size_t i = 0; i < n; i++)
+        {
+            __m128i record = _mm_loadu_si128((const __m128i*)(base + i * stride));
+            if ((_mm_movemask_epi8(_mm_cmpeq_epi8(record, needle)) & mask) == mask)
+                return true;
+        }
+        return false;
+#else
+        for (std::size_t i = 0; i < n; i++)
+        {
+            if (std::memcmp(base + i * stride, value, length) == 0)
+                return true;
+        }
+        return false;
+#endif
+    }
+
+    // Number of the n sorted records of length bytes starting at base, stride bytes apart,
+    // that are less than value, or with limit 1 not greater than value
+    static std::size_t count_window(const unsigned char* base, std::size_t stride, std::size_t n, const unsigned char* value, std::size_t length, int limit)
+    {
+#if defined(SAI_CORE_GUID_COLUMN_SSE2)
+        // The first differing byte orders a record against value, SSE2 only compares
+        // signed bytes so both sides are biased by 0x80 first
+        unsigned char padded[16] = {};
+        std::memcpy(padded, value, length);
+        __m128i needle = _mm_loadu_si128((const __m128i*)padded);
+        __m128i bias = _mm_set1_epi8((char)0x80);
+        __m128i biased_needle = _mm_xor_si128(needle, bias);
+        unsigned mask = (1u << length) - 1;
+        std::size_t count = 0;
+        for (std::size_t i = 0; i < n; i++)
+        {
+            __m128i record = _mm_loadu_si128((const __m128i*)(base + i * stride));
+            unsigned differ = ~(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(record, needle)) & mask;
+            unsigned less = (unsigned)_mm_movemask_epi8(_mm_cmplt_epi8(_mm_xor_si128(record, bias), biased_needle));
+            count += differ == 0 ? (std::size_t)limit : (less & differ & (0u - differ)) != 0;
+        }
+        return count;
+#else
+        std::size_t count = 0;
+        for (std::size_t i = 0; i < n; i++)
+            count += std::memcmp(base + i * stride, value, length) < limit;
+        return count;
+#endif
+    }
+
+    // True if the directory places every block's records within the available bytes
+    // after it
+    bool valid_blocks(std::size_t available) const
+    {
+        for (std::size_t b = 0; b < blocks_; b++)
+        {
+            const unsigned char* entry = directory_ + b * directory_entry_size;
+            std::size_t prefix = entry[24];
+            if (prefix > 15)
+                return false;
+            std::uint64_t offset = load_little_endian(entry + 16, 8);
+            std::uint64_t size = (std::uint64_t)block_count(b) * (16 - prefix);
+            if (offset > available || size > available - offset)
+                return false;
+        }
+        return true;
+    }
+
+    std::size_t block_count(std::size_t block) const
+    {
+        std::size_t remaining = count_ - block * block_size_;
+        return remaining < block_size_ ? remaining : block_size_;
+    }
+
+    // The last block whose first guid is less than bytes, or with limit 1 not greater
+    // than bytes, or the first block if there is none
+    std::size_t find_block(const unsigned char* bytes, int limit) const
+    {
+        std::size_t first = 0;
+        std::size_t n = blocks_;
+        while (n > 1)
+        {
+            std::size_t half = n / 2;
+            first = std::memcmp(directory_ + (first + half) * directory_entry_size, bytes, 16) < limit ? first + half : first;
+            n -= half;
+        }
+        return first;
+    }
+
+    // Index of the first record greater than bytes if upper is true, otherwise of the first not less than bytes
+    std::size_t bound(const unsigned char* bytes, bool upper) const
+    {
+        int limit = upper ? 1 : 0;
+        if (compression_ == guid_column_compression::none)
+        {
+            // Bisect down to a window of 8 records, then count the window's records
+            // before value at once
+            const unsigned char* base = records_;
+            std::size_t n = count_;
+            while (n > 8)
+            {
+                std::size_t half = n / 2;
+                base = std::memcmp(base + (half - 1) * 16, bytes, 16) < limit ? base + half * 16 : base;
+                n -= half;
+            }
+            return (std::size_t)(base - records_) / 16 + count_window(base, 16, n, bytes, 16, limit);
+        }
+
+        if (blocks_ == 0)
+            return 0;
+        std::size_t block = find_block(bytes, limit);
+        const unsigned char* entry = directory_ + block * directory_entry_size;
+        std::size_t prefix = entry[24];
+        std::size_t n = block_count(block);
+        std::size_t start = block * block_size_;
+
+        // Every record of the block shares the prefix, so comparing the prefix alone
+        // can place value before or after the whole block
+        int c = std::memcmp(entry, bytes, prefix);
+        if (c > 0)
+            return start;
+        if (c < 0)
+            return start + n;
+
+        std::size_t stride = 16 - prefix;
+        const unsigned char* records = records_ + load_little_endian(entry + 16, 8);
+        const unsigned char* base = records;
+        while (n > 8)
+        {
+            std::size_t half = n / 2;
+            base = std::memcmp(base + (half - 1) * stride, bytes + prefix, stride) < limit ? base + half * stride : base;
+            n -= half;
+        }
+        return start + (std::size_t)(base - records) / stride + count_window(base, stride, n, bytes + prefix, stride, limit);
+    }
+
+    mapped_file file_;
+    const unsigned char* records_ = nullptr;
+    const unsigned char* directory_ = nullptr;
+    std::size_t count_ = 0;
+    std::size_t blocks_ = 0;
+    std::size_t block_size_ = block_size;
+    guid_column_compression compression_ = guid_column_compression::none;
+};
+
+#endif
@@ -0,0 +1,483 @@
+// sai - General purpose self-contained C++ libraries.
+//
+// guid_map.h
+// Flat open addressing hash map and set keyed on GUIDs.
+// 
+// MIT License
+// 
+// Copyright (c) 2017 Ion Todirel
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef SAI_CORE_GUID_MAP_H
+#define SAI_CORE_GUID_MAP_H
+
+#include "guid.h"
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <utility>
+#include <iterator>
+#include <stdexcept>
+#include <tuple>
+
+#if !defined(SAI_CORE_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define SAI_CORE_GUID_MAP_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Storage shared by guid_map and guid_set. Slots live in one flat array next to an
+// array of control bytes, one per slot, holding 7 bits of the key's hash or marking
+// the slot empty or deleted. Lookups probe 16 control bytes at a time, so a lookup
+// usually touches one line of control bytes and one slot.
+template <class Value, class KeyOf>
+class guid_hash_table
+{
+public:
+    using key_type = guid;
+    using value_type = Value;
+    using size_type = std::size_t;
+
+    template <class TableValue>
+    class basic_iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Value;
+        using difference_type = std::ptrdiff_t;
+        using pointer = TableValue*;
+        using reference = TableValue&;
+
+        basic_iterator() {}
+        basic_iterator(const unsigned char* ctrl, TableValue* slot, const unsigned char* ctrl_end) : ctrl_(ctrl), slot_(slot), ctrl_end_(ctrl_end) { skip_free(); }
+
+        template <class OtherValue>
+        basic_iterator(const basic_iterator<OtherValue>& other) : ctrl_(other.ctrl_), slot_(other.slot_), ctrl_end_(other.ctrl_end_) {}
+
+        reference operator*() const { return *slot_; }
+        pointer operator->() const { return slot_; }
+
+        basic_iterator& operator++()
+        {
+            ctrl_++;
+            slot_++;
+            skip_free();
+            return *this;
+        }
+
+        basic_iterator operator++(int)
+        {
+            basic_iterator it(*this);
+            operator++();
+            return it;
+        }
+
+        bool operator==(const basic_iterator& other) const { return ctrl_ == other.ctrl_; }
+        bool operator!=(const basic_iterator& other) const { return ctrl_ != other.ctrl_; }
+
+    private:
+        template <class, class> friend class guid_hash_table;
+        template <class> friend class basic_iterator;
+
+        void skip_free()
+        {
+            while (ctrl_ != ctrl_end_ && (*ctrl_ & 0x80) != 0)
+            {
+                ctrl_++;
+                slot_++;
+            }
+        }
+
+        const unsigned char* ctrl_ = nullptr;
+        TableValue* slot_ = nullptr;
+        const unsigned char* ctrl_end_ = nullptr;
+    };
+
+    using iterator = basic_iterator<Value>;
+    using const_iterator = basic_iterator<const Value>;
+
+    guid_hash_table() {}
+
+    guid_hash_table(const guid_hash_table& other)
+    {
+        reserve(other.size_);
+        for (const Value& value : other)
+            insert_unique(KeyOf::key(value), value);
+    }
+
+    guid_hash_table(guid_hash_table&& other) noexcept
+    {
+        swap(other);
+    }
+
+    ~guid_hash_table()
+    {
+        destroy();
+    }
+
+    guid_hash_table& operator=(const guid_hash_table& other)
+    {
+        if (this != &other)
+        {
+            guid_hash_table copy(other);
+            swap(copy);
+        }
+        return *this;
+    }
+
+    guid_hash_table& operator=(guid_hash_table&& other) noexcept
+    {
+        if (this != &other)
+        {
+            destroy();
+            swap(other);
+        }
+        return *this;
+    }
+
+    void swap(guid_hash_table& other) noexcept
+    {
+        std::swap(ctrl_, other.ctrl_);
+        std::swap(slots_, other.slots_);
+        std::swap(capacity_, other.capacity_);
+        std::swap(size_, other.size_);
+        std::swap(deleted_, other.deleted_);
+    }
+
+    iterator begin() { return iterator(ctrl_.get(), slots_, ctrl_.get() + capacity_); }
+    iterator end() { return iterator(ctrl_.get() + capacity_, slots_ + capacity_, ctrl_.get() + capacity_); }
+    const_iterator begin() const { return const_iterator(ctrl_.get(), slots_, ctrl_.get() + capacity_); }
+    const_iterator end() const { return const_iterator(ctrl_.get() + capacity_, slots_ + capacity_, ctrl_.get() + capacity_); }
+
+    size_type size() const { return size_; }
+    size_type capacity() const { return capacity_; }
+    bool empty() const { return size_ == 0; }
+
+    void clear()
+    {
+        for (size_type i = 0; i < capacity_; i++)
+        {
+            if ((ctrl_[i] & 0x80) == 0)
+                slots_[i].~Value();
+        }
+        if (capacity_ > 0)
+            std::memset(ctrl_.get(), ctrl_empty, capacity_);
+        size_ = 0;
+        deleted_ = 0;
+    }
+
+    // Makes room for count elements without rehashing
+    void reserve(size_type count)
+    {
+        size_type capacity = group_size;
+        while (capacity - capacity / 8 < count)
+            capacity *= 2;
+        if (capacity > capacity_)
+            rehash(capacity);
+    }
+
+    iterator find(const guid& key)
+    {
+        size_type index = find_index(key);
+        return index == npos ? end() : iterator_at(index);
+    }
+
+    const_iterator find(const guid& key) const
+    {
+        size_type index = find_index(key);
+        return index == npos ? end() : const_iterator(ctrl_.get() + index, slots_ + index, ctrl_.get() + capacity_);
+    }
+
+    bool contains(const guid& key) const
+    {
+        return find_index(key) != npos;
+    }
+
+    size_type count(const guid& key) const
+    {
+        return contains(key) ? 1 : 0;
+    }
+
+    size_type erase(const guid& key)
+    {
+        size_type index = find_index(key);
+        if (index == npos)
+            return 0;
+        erase_index(index);
+        return 1;
+    }
+
+    iterator erase(const_iterator pos)
+    {
+        size_type index = (size_type)(pos.ctrl_ - ctrl_.get());
+        erase_index(index);
+        return iterator_at(index + 1);
+    }
+
+protected:
+    static constexpr size_type group_size = 16;
+    static constexpr size_type npos = (size_type)-1;
+    static constexpr unsigned char ctrl_empty = 0x80;
+    static constexpr unsigned char ctrl_deleted = 0xFE;
+
+    iterator iterator_at(size_type index)
+    {
+        return iterator(ctrl_.get() + index, slots_ + index, ctrl_.get() + capacity_);
+    }
+
+    size_type find_index(const guid& key) const
+    {
+        if (capacity_ == 0)
+            return npos;
+
+        std::size_t hash = key.hash();
+        unsigned char h2 = (unsigned char)(hash & 0x7F);
+        size_type group_mask = capacity_ / group_size - 1;
+        size_type group = (hash >> 7) & group_mask;
+        for (size_type probe = 1;; probe++)
+        {
+            const unsigned char* ctrl = ctrl_.get() + group * group_size;
+            for (unsigned match = match_byte(ctrl, h2); match != 0; match &= match - 1)
+            {
+                size_type index = group * group_size + trailing_zeros(match);
+                if (KeyOf::key(slots_[index]) == key)
+                    return index;
+            }
+            if (match_byte(ctrl, ctrl_empty) != 0)
+                return npos;
+            group = (group + probe) & group_mask;
+        }
+    }
+
+    // Returns the slot holding key, or constructs a new element from args if the key
+    // is not in the table yet, the bool is true if the element was inserted
+    template <class... Args>
+    std::pair<iterator, bool> insert_unique(const guid& key, Args&&... args)
+    {
+        size_type index = find_index(key);
+        if (index != npos)
+            return { iterator_at(index), false };
+
+        if (size_ + deleted_ + 1 > capacity_ - capacity_ / 8)
+            rehash(size_ + 1 > (capacity_ - capacity_ / 8) / 2 ? (capacity_ == 0 ? group_size : capacity_ * 2) : capacity_);
+
+        std::size_t hash = key.hash();
+        index = find_free(hash);
+        ::new ((void*)(slots_ + index)) Value(std::forward<Args>(args)...);
+        if (ctrl_[index] == ctrl_deleted)
+            deleted_--;
+        ctrl_[index] = (unsigned char)(hash & 0x7F);
+        size_++;
+        return { iterator_at(index), true };
+    }
+
+private:
+    size_type find_free(std::size_t hash) const
+    {
+        size_type group_mask = capacity_ / group_size - 1;
+        size_type group = (hash >> 7) & group_mask;
+        for (size_type probe = 1;; probe++)
+        {
+            // Empty and deleted are the only control bytes with the top bit set
+            unsigned match = match_free(ctrl_.get() + group * group_size);
+            if (match != 0)
+                return group * group_size + trailing_zeros(match);
+            group = (group + probe) & group_mask;
+        }
+    }
+
+    void erase_index(size_type index)
+    {
+        slots_[index].~Value();
+        // Probing only moves past a group with no empty slots, if this group still
+        // has one no probe sequence can run through it and the slot can become empty
+        const unsigned char* group = ctrl_.get() + index / group_size * group_size;
+        if (match_byte(group, ctrl_empty) != 0)
+        {
+            ctrl_[index] = ctrl_empty;
+        }
+        else
+        {
+            ctrl_[index] = ctrl_deleted;
+            deleted_++;
+        }
+        size_--;
+    }
+
+    void rehash(size_type capacity)
+    {
+        std::unique_ptr<unsigned char[]> ctrl(new unsigned char[capacity]);
+        std::memset(ctrl.get(), ctrl_empty, capacity);
+        Value* slots = std::allocator<Value>().allocate(capacity);
+
+        std::unique_ptr<unsigned char[]> old_ctrl = std::move(ctrl_);
+        Value* old_slots = slots_;
+        size_type old_capacity = capacity_;
+
+        ctrl_ = std::move(ctrl);
+        slots_ = slots;
+        capacity_ = capacity;
+        deleted_ = 0;
+
+        for (size_type i = 0; i < old_capacity; i++)
+        {
+            if ((old_ctrl[i] & 0x80) != 0)
+                continue;
+            std::size_t hash = KeyOf::key(old_slots[i]).hash();
+            size_type index = find_free(hash);
+            ::new ((void*)(slots_ + index)) Value(std::move(old_slots[i]));
+            ctrl_[index] = (unsigned char)(hash & 0x7F);
+            old_slots[i].~Value();
+        }
+
+        if (old_slots != nullptr)
+            std::allocator<Value>().deallocate(old_slots, old_capacity);
+    }
+
+    void destroy()
+    {
+        clear();
+        if (slots_ != nullptr)
+            std::allocator<Value>().deallocate(slots_, capacity_);
+        ctrl_.reset();
+        slots_ = nullptr;
+        capacity_ = 0;
+    }
+
+    // Bit i of the result is set if ctrl[i] == value
+    static unsigned match_byte(const unsigned char* ctrl, unsigned char value)
+    {
+#if defined(SAI_CORE_GUID_MAP_SSE2)
+        __m128i group = _mm_loadu_si128((const __m128i*)ctrl);
+        return (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)value)));
+#else
+        unsigned mask = 0;
+        for (size_type i = 0; i < group_size; i++)
+            mask |= (unsigned)(ctrl[i] == value) << i;
+        return mask;
+#endif
+    }
+
+    static unsigned match_free(const unsigned char* ctrl)
+    {
+#if defined(SAI_CORE_GUID_MAP_SSE2)
+        return (unsigned)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)ctrl));
+#else
+        unsigned mask = 0;
+        for (size_type i = 0; i < group_size; i++)
+            mask |= (unsigned)(ctrl[i] >> 7) << i;
+        return mask;
+#endif
+    }
+
+    static size_type trailing_zeros(unsigned mask)
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return index;
+#else
+        return (size_type)__builtin_ctz(mask);
+#endif
+    }
+
+    std::unique_ptr<unsigned char[]> ctrl_;
+    Value* slots_ = nullptr;
+    size_type capacity_ = 0;
+    size_type size_ = 0;
+    size_type deleted_ = 0;
+};
+
+struct guid_map_key
+{
+    template <class Value>
+    static const guid& key(const Value& value) { return value.first; }
+};
+
+struct guid_set_key
+{
+    static const guid& key(const guid& value) { return value; }
+};
+
+template <class T>
+class guid_map : public guid_hash_table<std::pair<const guid, T>, guid_map_key>
+{
+    using base = guid_hash_table<std::pair<const guid, T>, guid_map_key>;
+
+public:
+    using mapped_type = T;
+    using typename base::value_type;
+    using typename base::iterator;
+    using typename base::const_iterator;
+
+    std::pair<iterator, bool> insert(const value_type& value)
+    {
+        return base::insert_unique(value.first, value);
+    }
+
+    std::pair<iterator, bool> insert(const guid& key, const T& value)
+    {
+        return base::insert_unique(key, key, value);
+    }
+
+    template <class... Args>
+    std::pair<iterator, bool> try_emplace(const guid& key, Args&&... args)
+    {
+        return base::insert_unique(key, std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Args>(args)...));
+    }
+
+    T& operator[](const guid& key)
+    {
+        return try_emplace(key).first->second;
+    }
+
+    T& at(const guid& key)
+    {
+        iterator it = base::find(key);
+        if (it == base::end())
+            throw std::out_of_range("guid not found.");
+        return it->second;
+    }
+
+    const T& at(const guid& key) const
+    {
+        const_iterator it = base::find(key);
+        if (it == base::end())
+            throw std::out_of_range("guid not found.");
+        return it->second;
+    }
+};
+
+class guid_set : public guid_hash_table<guid, guid_set_key>
+{
+    using base = guid_hash_table<guid, guid_set_key>;
+
+public:
+    std::pair<iterator, bool> insert(const guid& value)
+    {
+        return base::insert_unique(value, value);
+    }
+};
+
+#endif
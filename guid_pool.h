@@ -0,0 +1,390 @@
+// sai - General purpose self-contained C++ libraries.
+//
+// guid_pool.h
+// Lock-free pool of pre-generated GUIDs.
+// 
+// MIT License
+// 
+// Copyright (c) 2017 Ion Todirel
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef SAI_CORE_GUID_POOL_H
+#define SAI_CORE_GUID_POOL_H
+
+#include "guid.h"
+
+#include <cstddef>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <memory>
+
+enum class guid_pool_refill
+{
+    // a background thread tops the pool up whenever it drops below half full
+    background,
+    // the thread that finds the pool empty refills it
+    on_demand
+};
+
+// Bounded multi-producer multi-consumer ring of pre-generated version 4 guids.
+// Each cell carries a sequence number telling producers and consumers whose turn
+// it is, so acquiring a guid takes one compare and swap on the read position when
+// the pool is not empty. An empty pool never blocks: the guid is generated
+// directly and counted as a miss.
+// A forked child inherits the ring, whose guids the parent also hands out. The
+// first use of the pool in the child discards them, refills the ring and starts a
+// new refill thread before serving from it again.
+class guid_pool
+{
+public:
+    explicit guid_pool(std::size_t capacity = 65536, guid_pool_refill mode = guid_pool_refill::background) : refill_mode_(mode)
+    {
+        capacity_ = 64;
+        while (capacity_ < capacity)
+            capacity_ *= 2;
+        cells_.reset(new cell[capacity_]);
+        for (std::size_t i = 0; i < capacity_; i++)
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+
+        generation_.store(system_fork_generation(), std::memory_order_relaxed);
+        fill(capacity_);
+        start_worker();
+    }
+
+    guid_pool(const guid_pool&) = delete;
+    guid_pool& operator=(const guid_pool&) = delete;
+
+    ~guid_pool()
+    {
+        uninstall();
+        if (!worker_)
+            return;
+        // In a forked child that never used the pool the refill thread does not exist
+        // and its mutex may be held, so its state is left behind instead of joined
+        if (generation_.load(std::memory_order_acquire) != system_fork_generation())
+        {
+            (void)worker_.release();
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(worker_->mutex);
+            worker_->stop = true;
+        }
+        worker_->condition.notify_one();
+        worker_->thread.join();
+    }
+
+    guid acquire()
+    {
+        guid g;
+        if (try_acquire(g))
+            return g;
+
+        misses_.fetch_add(1, std::memory_order_relaxed);
+        if (refill_mode_ == guid_pool_refill::on_demand)
+        {
+            refill(refill_batch_size);
+            if (try_acquire(g))
+                return g;
+        }
+        return guid::create_new(guid_version::v4);
+    }
+
+    // Takes a guid from the pool, returns false if the pool is empty
+    bool try_acquire(guid& result)
+    {
+        if (generation_.load(std::memory_order_acquire) != system_fork_generation() && !reset_after_fork())
+            return false;
+
+        std::size_t position = read_.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            cell& c = cells_[position & (capacity_ - 1)];
+            std::size_t sequence = c.sequence.load(std::memory_order_acquire);
+            std::ptrdiff_t difference = (std::ptrdiff_t)(sequence - (position + 1));
+            if (difference == 0)
+            {
+                if (read_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    result = c.value;
+                    c.sequence.store(position + capacity_, std::memory_order_release);
+                    break;
+                }
+            }
+            else if (difference < 0)
+            {
+                request_refill();
+                return false;
+            }
+            else
+            {
+                position = read_.load(std::memory_order_relaxed);
+            }
+        }
+
+        if (refill_mode_ == guid_pool_refill::background && size() < capacity_ / 2)
+            request_refill();
+        return true;
+    }
+
+    // Generates guids on the calling thread until the pool is full
+    void refill()
+    {
+        refill(capacity_);
+    }
+
+    // Generates up to count guids on the calling thread, stopping early if the pool is full
+    void refill(std::size_t count)
+    {
+        if (generation_.load(std::memory_order_acquire) != system_fork_generation() && !reset_after_fork())
+            return;
+        fill(count);
+    }
+
+    // Serves guid::create_new(), guid::create() and guid(createnew) from this pool
+    // until uninstall is called or the pool is destroyed. A pool replaced by another
+    // one is no longer used once install returns.
+    void install()
+    {
+        install_state& state = installed();
+        guid_pool* previous = state.pool.exchange(this, std::memory_order_seq_cst);
+        guid::generator(&guid_pool::acquire_installed);
+        if (previous != nullptr && previous != this)
+            wait_for_callers();
+    }
+
+    // Restores the default generator if this pool is installed, and returns once no
+    // call that found this pool installed is still using it
+    void uninstall()
+    {
+        guid_pool* self = this;
+        if (installed().pool.compare_exchange_strong(self, nullptr, std::memory_order_seq_cst))
+        {
+            guid::generator(nullptr);
+            wait_for_callers();
+        }
+    }
+
+    std::size_t capacity() const { return capacity_; }
+
+    // Number of guids currently in the pool
+    std::size_t size() const
+    {
+        std::size_t read = read_.load(std::memory_order_relaxed);
+        std::size_t write = write_.load(std::memory_order_relaxed);
+        return write > read ? write - read : 0;
+    }
+
+    // Number of guids taken from the pool
+    unsigned long long acquired() const { return read_.load(std::memory_order_relaxed); }
+    // Number of acquire calls that found the pool empty
+    unsigned long long misses() const { return misses_.load(std::memory_order_relaxed); }
+    // Number of refill passes, from the background thread or on demand
+    unsigned long long refills() const { return refills_.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr std::size_t refill_batch_size = 256;
+
+    struct cell
+    {
+        std::atomic<std::size_t> sequence;
+        guid value;
+    };
+
+    // State of the background refill thread. A forked child gets a new one, the
+    // copy inherited from the parent has no thread and may have its mutex held.
+    struct refill_worker
+    {
+        std::mutex mutex;
+        std::condition_variable condition;
+        bool stop = false;
+        std::thread thread;
+    };
+
+    // Callers of the installed pool are counted in one of two slots picked by epoch.
+    // Replacing the pool moves new callers to the other slot, then waits for the old
+    // slot to drain, so it cannot be starved by a steady stream of calls.
+    struct install_state
+    {
+        std::atomic<guid_pool*> pool{ nullptr };
+        std::atomic<unsigned> epoch{ 0 };
+        std::atomic<std::size_t> callers[2] = {};
+        std::atomic<bool> waiting{ false };
+    };
+
+    static install_state& installed()
+    {
+        static install_state state;
+#if !defined(_WIN32)
+        // Calls in flight on the parent's other threads never finish in a forked child
+        static const bool registered = pthread_atfork(nullptr, nullptr, []()
+        {
+            state.callers[0].store(0, std::memory_order_relaxed);
+            state.callers[1].store(0, std::memory_order_relaxed);
+            state.waiting.store(false, std::memory_order_relaxed);
+        }) == 0;
+        (void)registered;
+#endif
+        return state;
+    }
+
+    static guid acquire_installed()
+    {
+        install_state& state = installed();
+        std::atomic<std::size_t>& slot = state.callers[state.epoch.load(std::memory_order_seq_cst) & 1];
+        slot.fetch_add(1, std::memory_order_seq_cst);
+        struct release_slot
+        {
+            std::atomic<std::size_t>& slot;
+            ~release_slot() { slot.fetch_sub(1, std::memory_order_release); }
+        } release{ slot };
+        guid_pool* pool = state.pool.load(std::memory_order_seq_cst);
+        return pool != nullptr ? pool->acquire() : guid::create_new(guid_version::v4);
+    }
+
+    // The pool was swapped out before this is called, a caller counted in the old slot
+    // may still use it, one counted afterwards loads the pool after the swap
+    static void wait_for_callers()
+    {
+        install_state& state = installed();
+        while (state.waiting.exchange(true, std::memory_order_acquire))
+            std::this_thread::yield();
+        unsigned epoch = state.epoch.fetch_add(1, std::memory_order_seq_cst);
+        while (state.callers[epoch & 1].load(std::memory_order_seq_cst) != 0)
+            std::this_thread::yield();
+        state.waiting.store(false, std::memory_order_release);
+    }
+
+    void start_worker()
+    {
+        if (refill_mode_ != guid_pool_refill::background)
+            return;
+        worker_.reset(new refill_worker);
+        refill_worker* worker = worker_.get();
+        worker->thread = std::thread([this, worker]() { run(*worker); });
+    }
+
+    void fill(std::size_t count)
+    {
+        refills_.fetch_add(1, std::memory_order_relaxed);
+        for (std::size_t i = 0; i < count; i++)
+        {
+            if (!push(guid::create_new(guid_version::v4)))
+                return;
+        }
+    }
+
+    // Called when the pool is first used in a forked child. One caller empties the
+    // ring, refills it with guids drawn in the child and starts a new refill thread,
+    // other callers are turned away until it is done and generate their guids directly.
+    bool reset_after_fork()
+    {
+        if (resetting_.exchange(true, std::memory_order_acquire))
+            return false;
+        unsigned generation = system_fork_generation();
+        if (generation_.load(std::memory_order_relaxed) != generation)
+        {
+            (void)worker_.release();
+            for (std::size_t i = 0; i < capacity_; i++)
+                cells_[i].sequence.store(i, std::memory_order_relaxed);
+            read_.store(0, std::memory_order_relaxed);
+            write_.store(0, std::memory_order_relaxed);
+            refill_requested_.store(false, std::memory_order_relaxed);
+            fill(capacity_);
+            start_worker();
+            generation_.store(generation, std::memory_order_release);
+        }
+        resetting_.store(false, std::memory_order_release);
+        return true;
+    }
+
+    bool push(const guid& value)
+    {
+        std::size_t position = write_.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            cell& c = cells_[position & (capacity_ - 1)];
+            std::size_t sequence = c.sequence.load(std::memory_order_acquire);
+            std::ptrdiff_t difference = (std::ptrdiff_t)(sequence - position);
+            if (difference == 0)
+            {
+                if (write_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    c.value = value;
+                    c.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (difference < 0)
+            {
+                return false;
+            }
+            else
+            {
+                position = write_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void request_refill()
+    {
+        if (refill_mode_ != guid_pool_refill::background || refill_requested_.exchange(true, std::memory_order_acq_rel))
+            return;
+        // Taking the lock orders the request with the refill thread going to sleep,
+        // it only happens once per refill so the fast path stays lock-free
+        {
+            std::lock_guard<std::mutex> lock(worker_->mutex);
+        }
+        worker_->condition.notify_one();
+    }
+
+    void run(refill_worker& worker)
+    {
+        std::unique_lock<std::mutex> lock(worker.mutex);
+        for (;;)
+        {
+            worker.condition.wait(lock, [&]() { return worker.stop || refill_requested_.load(std::memory_order_acquire); });
+            if (worker.stop)
+                return;
+            lock.unlock();
+            refill_requested_.store(false, std::memory_order_release);
+            fill(capacity_);
+            lock.lock();
+        }
+    }
+
+    std::unique_ptr<cell[]> cells_;
+    std::size_t capacity_ = 0;
+    guid_pool_refill refill_mode_;
+    alignas(64) std::atomic<std::size_t> read_{ 0 };
+    alignas(64) std::atomic<std::size_t> write_{ 0 };
+    alignas(64) std::atomic<bool> refill_requested_{ false };
+    std::atomic<unsigned long long> misses_{ 0 };
+    std::atomic<unsigned long long> refills_{ 0 };
+    // Fork generation the ring's guids were drawn in
+    std::atomic<unsigned> generation_{ 0 };
+    std::atomic<bool> resetting_{ false };
+    std::unique_ptr<refill_worker> worker_;
+};
+
+#endif
@@ -0,0 +1,193 @@
+// sai - General purpose self-contained C++ libraries.
+//
+// mapped_file.h
+// Read-only memory mapped files.
+// 
+// MIT License
+// 
+// Copyright (c) 2017 Ion Todirel
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef SAI_CORE_MAPPED_FILE_H
+#define SAI_CORE_MAPPED_FILE_H
+
+#include <string>
+#include <string_view>
+#include <cstddef>
+#include <system_error>
+#include <utility>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+// How the mapping will be read, passed to the operating system as a paging hint
+enum class mapped_file_access
+{
+    // no hint
+    normal,
+    // front to back once, pages are read ahead and may be dropped behind the reader
+    sequential,
+    // scattered reads such as binary searches, read ahead is turned off
+    random
+};
+
+// Maps a whole file into memory for reading. The mapping is released when the
+// object is destroyed or closed, views returned by data() and view() do not
+// outlive it.
+class mapped_file
+{
+public:
+    mapped_file() {}
+
+    explicit mapped_file(const std::string& path, mapped_file_access access = mapped_file_access::sequential)
+    {
+        open(path, access);
+    }
+
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+
+    mapped_file(mapped_file&& other) noexcept
+    {
+        swap(other);
+    }
+
+    mapped_file& operator=(mapped_file&& other) noexcept
+    {
+        if (this != &other)
+        {
+            close();
+            swap(other);
+        }
+        return *this;
+    }
+
+    ~mapped_file()
+    {
+        close();
+    }
+
+    void swap(mapped_file& other) noexcept
+    {
+        std::swap(data_, other.data_);
+        std::swap(size_, other.size_);
+        std::swap(open_, other.open_);
+    }
+
+    void open(const std::string& path, mapped_file_access access = mapped_file_access::sequential)
+    {
+        close();
+#if defined(_WIN32)
+        DWORD flags = access == mapped_file_access::sequential ? FILE_FLAG_SEQUENTIAL_SCAN : access == mapped_file_access::random ? FILE_FLAG_RANDOM_ACCESS : FILE_ATTRIBUTE_NORMAL;
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, flags, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            throw std::system_error(std::error_code((int)GetLastError(), std::system_category()), "Could not open " + path + ".");
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size))
+        {
+            DWORD error = GetLastError();
+            CloseHandle(file);
+            throw std::system_error(std::error_code((int)error, std::system_category()), "Could not read the size of " + path + ".");
+        }
+        if (size.QuadPart > 0)
+        {
+            HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            DWORD error = GetLastError();
+            CloseHandle(file);
+            if (mapping == nullptr)
+                throw std::system_error(std::error_code((int)error, std::system_category()), "Could not map " + path + ".");
+            void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            error = GetLastError();
+            CloseHandle(mapping);
+            if (data == nullptr)
+                throw std::system_error(std::error_code((int)error, std::system_category()), "Could not map " + path + ".");
+            data_ = (const char*)data;
+        }
+        else
+        {
+            CloseHandle(file);
+        }
+        size_ = (std::size_t)size.QuadPart;
+#else
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            throw std::system_error(std::error_code(errno, std::system_category()), "Could not open " + path + ".");
+        struct stat st;
+        if (fstat(fd, &st) != 0)
+        {
+            int error = errno;
+            ::close(fd);
+            throw std::system_error(std::error_code(error, std::system_category()), "Could not read the size of " + path + ".");
+        }
+        if (st.st_size > 0)
+        {
+            void* data = mmap(nullptr, (std::size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            int error = errno;
+            ::close(fd);
+            if (data == MAP_FAILED)
+                throw std::system_error(std::error_code(error, std::system_category()), "Could not map " + path + ".");
+            if (access != mapped_file_access::normal)
+                madvise(data, (std::size_t)st.st_size, access == mapped_file_access::sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+            data_ = (const char*)data;
+        }
+        else
+        {
+            ::close(fd);
+        }
+        size_ = (std::size_t)st.st_size;
+#endif
+        open_ = true;
+    }
+
+    void close()
+    {
+        if (data_ != nullptr)
+        {
+#if defined(_WIN32)
+            UnmapViewOfFile(data_);
+#else
+            munmap((void*)data_, size_);
+#endif
+        }
+        data_ = nullptr;
+        size_ = 0;
+        open_ = false;
+    }
+
+    bool is_open() const { return open_; }
+    const char* data() const { return data_; }
+    std::size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    std::string_view view() const { return std::string_view(data_, size_); }
+
+private:
+    const char* data_ = nullptr;
+    std::size_t size_ = 0;
+    bool open_ = false;
+};
+
+#endif
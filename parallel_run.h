@@ -0,0 +1,88 @@
+// sai - General purpose self-contained C++ libraries.
+//
+// parallel_run.h
+// Runs a function on several threads at once.
+// 
+// MIT License
+// 
+// Copyright (c) 2017 Ion Todirel
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef SAI_CORE_PARALLEL_RUN_H
+#define SAI_CORE_PARALLEL_RUN_H
+
+#include <thread>
+#include <vector>
+#include <mutex>
+#include <exception>
+
+// Number of threads to use for a thread_count argument, where 0 means one per core
+inline unsigned parallel_thread_count(unsigned thread_count)
+{
+    if (thread_count == 0)
+        thread_count = std::thread::hardware_concurrency();
+    return thread_count == 0 ? 1 : thread_count;
+}
+
+// Calls work(i) for every i in [0, count), each on its own thread except work(0),
+// which runs on the calling thread, and returns once all calls have finished. If calls
+// throw, the first exception caught is rethrown on the calling thread after the joins
+// instead of terminating the process.
+template <class Index, class Work>
+inline void parallel_run(Index count, Work&& work)
+{
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    auto guarded = [&](Index i)
+    {
+        try
+        {
+            work(i);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (!error)
+                error = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    try
+    {
+        for (Index i = 1; i < count; i++)
+            threads.emplace_back(guarded, i);
+    }
+    catch (...)
+    {
+        // Threads that did start still reference the work, they are joined before the
+        // failure to start the others propagates
+        for (std::thread& thread : threads)
+            thread.join();
+        throw;
+    }
+    guarded(Index(0));
+    for (std::thread& thread : threads)
+        thread.join();
+    if (error)
+        std::rethrow_exception(error);
+}
+
+#endif
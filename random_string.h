@@ -1,7 +1,7 @@
 // sai - General purpose self-contained C++ libraries.
 //
 // random_string.h
-// Utility function for generating random strings of specified lengths.
+// Utility functions for generating random strings of specified lengths.
 // 
 // MIT License
 // 
@@ -24,47 +24,903 @@
 // LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
-
 #ifndef SAI_CORE_RANDOM_STRING
 #define SAI_CORE_RANDOM_STRING
 
+#include "system_random.h"
+
 #include <string>
+#include <string_view>
 #include <random>
 #include <algorithm>
-#include <iterator>
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <system_error>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+#include <initializer_list>
+#include <cmath>
+
+#if !defined(SAI_CORE_NO_SIMD) && defined(__AVX2__)
+#define SAI_CORE_RANDOM_STRING_AVX2
+#include <immintrin.h>
+#endif
+
+#ifndef SAI_CORE_SECURE
+#define SAI_CORE_SECURE
+
+struct secure_t {
+    constexpr secure_t() {}
+};
+
+constexpr secure_t secure;
+
+#endif
+
+// xoshiro256** by Blackman and Vigna, a small and fast generator for non cryptographic
+// use with 256 bits of state. Satisfies UniformRandomBitGenerator.
+class xoshiro256_engine
+{
+public:
+    using result_type = std::uint64_t;
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return ~(result_type)0; }
+
+    explicit xoshiro256_engine(std::uint64_t seed_value = 0)
+    {
+        seed(seed_value);
+    }
+
+    xoshiro256_engine(std::uint64_t seed_value, std::uint64_t stream)
+    {
+        seed(seed_value, stream);
+    }
+
+    // Expands the seed into the state with splitmix64, which never yields the all zero state
+    void seed(std::uint64_t seed_value)
+    {
+        for (std::uint64_t& word : state_)
+        {
+            seed_value += 0x9E3779B97F4A7C15ull;
+            word = mix(seed_value);
+        }
+    }
+
+    // Seeds stream number stream of seed_value, so one seed can be split into numbered
+    // streams that are computed independently, like the blocks of a parallel fill
+    void seed(std::uint64_t seed_value, std::uint64_t stream)
+    {
+        seed(seed_value ^ mix(stream * 0x9E3779B97F4A7C15ull + 0xD1B54A32D192ED03ull));
+    }
+
+    result_type operator()()
+    {
+        std::uint64_t result = rotl(state_[1] * 5, 7) * 9;
+        std::uint64_t t = state_[1] << 17;
+        state_[2] ^= state_[0];
+        state_[3] ^= state_[1];
+        state_[1] ^= state_[2];
+        state_[0] ^= state_[3];
+        state_[2] ^= t;
+        state_[3] = rotl(state_[3], 45);
+        return result;
+    }
+
+    bool operator == (const xoshiro256_engine& other) const
+    {
+        return std::equal(state_, state_ + 4, other.state_);
+    }
+
+    bool operator != (const xoshiro256_engine& other) const
+    {
+        return !(*this == other);
+    }
+
+private:
+    static std::uint64_t rotl(std::uint64_t x, int k)
+    {
+        return (x << k) | (x >> (64 - k));
+    }
+
+    // splitmix64 output function
+    static std::uint64_t mix(std::uint64_t z)
+    {
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+private:
+    std::uint64_t state_[4];
+};
+
+// Draws from the operating system's cryptographically secure generator, BCryptGenRandom,
+// arc4random or getrandom, through a per thread buffer so most calls do not enter the
+// kernel. Satisfies UniformRandomBitGenerator.
+class secure_random_engine
+{
+public:
+    using result_type = std::uint64_t;
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return ~(result_type)0; }
+
+    result_type operator()()
+    {
+        return system_random_word<entropy_block_size>();
+    }
+
+private:
+    // Number of 64-bit words requested from the operating system at once
+    static constexpr std::size_t entropy_block_size = 512;
+};
+
+// The calling thread's xoshiro256_engine, seeded from the operating system the first time
+// a thread uses it and again in a forked child
+inline xoshiro256_engine& random_string_engine()
+{
+    struct seeded_engine
+    {
+        xoshiro256_engine engine;
+        unsigned generation = 0;
+        bool seeded = false;
+    };
+
+    thread_local seeded_engine state;
+    unsigned generation = system_fork_generation();
+    if (!state.seeded || state.generation != generation)
+    {
+        std::uint64_t seed = 0;
+        system_random_fill(&seed, sizeof(seed));
+        state.engine.seed(seed);
+        state.generation = generation;
+        state.seeded = true;
+    }
+    return state.engine;
+}
+
+// Integers passed where a generator is expected select the seeded overloads instead
+template <class Generator>
+using random_string_generator_t = std::enable_if_t<!std::is_integral<std::decay_t<Generator>>::value, int>;
+
+// 64 uniformly distributed bits from any UniformRandomBitGenerator
+template <class Generator>
+inline std::uint64_t random_string_word(Generator& generator)
+{
+    using result_type = typename std::decay_t<Generator>::result_type;
+    constexpr result_type min = std::decay_t<Generator>::min();
+    constexpr result_type max = std::decay_t<Generator>::max();
+    if constexpr (min == 0 && (std::uint64_t)max == ~(std::uint64_t)0)
+        return (std::uint64_t)generator();
+    else if constexpr (min == 0 && (std::uint64_t)max == 0xFFFFFFFFull)
+    {
+        std::uint64_t high = (std::uint64_t)generator();
+        return (high << 32) | (std::uint64_t)generator();
+    }
+    else
+        return std::uniform_int_distribution<std::uint64_t>()(generator);
+}
+
+// Hands out random bits from 64-bit generator words, 8 or 16 at a time
+template <class Generator>
+class random_string_bits
+{
+public:
+    explicit random_string_bits(Generator& generator) : generator_(generator) {}
+
+    template <unsigned Bits>
+    std::uint32_t next()
+    {
+        static_assert(Bits == 8 || Bits == 16, "Random bits are handed out 8 or 16 at a time.");
+        if (available_ < Bits)
+        {
+            word_ = random_string_word(generator_);
+            available_ = 64;
+        }
+        std::uint32_t result = (std::uint32_t)(word_ & ((1u << Bits) - 1));
+        word_ >>= Bits;
+        available_ -= Bits;
+        return result;
+    }
+
+    // Fills words with count fresh generator words, bypassing the buffered word
+    void fill(std::uint64_t* words, std::size_t count)
+    {
+        for (std::size_t i = 0; i < count; i++)
+            words[i] = random_string_word(generator_);
+    }
+
+    Generator& generator() { return generator_; }
+
+private:
+    Generator& generator_;
+    std::uint64_t word_ = 0;
+    unsigned available_ = 0;
+};
+
+// Uniform index below size, at most 2^Bits, with Lemire's multiply-shift over Bits random
+// bits. Products whose low half falls under 2^Bits % size are rejected and redrawn, which
+// is what makes the distribution exact.
+template <unsigned Bits, class Generator>
+inline std::size_t random_string_index(random_string_bits<Generator>& bits, std::uint32_t size, std::uint32_t threshold)
+{
+    for (;;)
+    {
+        std::uint32_t product = bits.template next<Bits>() * size;
+        if ((product & ((1u << Bits) - 1)) >= threshold)
+            return product >> Bits;
+    }
+}
+
+// The kernels take the alphabet size as Size when it is known at compile time, 0 when
+// it is not, so the choice of mapping and its constants fold away for fixed alphabets
+template <std::size_t Size, class CharType, class Generator>
+inline void random_string_fill_scalar(CharType* first, CharType* last, const CharType* allowed_chars, std::size_t allowed_count, random_string_bits<Generator>& bits)
+{
+    if constexpr (Size != 0)
+        allowed_count = Size;
+    // The bits are kept in locals rather than in bits, character stores may alias anything
+    // in memory and would force them to be reloaded for every character
+    Generator& generator = bits.generator();
+    std::uint64_t word = 0;
+    unsigned available = 0;
+    if (allowed_count <= 256 && (allowed_count & (allowed_count - 1)) == 0)
+    {
+        std::uint32_t mask = (std::uint32_t)allowed_count - 1;
+        for (CharType* p = first; p != last; p++)
+        {
+            if (available == 0)
+            {
+                word = random_string_word(generator);
+                available = 8;
+            }
+            *p = allowed_chars[word & mask];
+            word >>= 8;
+            available--;
+        }
+    }
+    else if (allowed_count <= 65536)
+    {
+        std::uint32_t size = (std::uint32_t)allowed_count;
+        std::uint32_t threshold = 65536 % size;
+        for (CharType* p = first; p != last;)
+        {
+            if (available == 0)
+            {
+                word = random_string_word(generator);
+                available = 4;
+            }
+            std::uint32_t product = (std::uint32_t)(word & 0xFFFF) * size;
+            word >>= 16;
+            available--;
+            if ((product & 0xFFFF) >= threshold)
+                *p++ = allowed_chars[product >> 16];
+        }
+    }
+    else
+    {
+        std::uniform_int_distribution<std::size_t> distribution(0, allowed_count - 1);
+        for (CharType* p = first; p != last; p++)
+            *p = allowed_chars[distribution(generator)];
+    }
+}
+
+#if defined(SAI_CORE_RANDOM_STRING_AVX2)
+// Fills at least this long seed four vector streams from a xoshiro256_engine instead of
+// drawing from it directly, the seeding costs about as much as 20 draws
+constexpr std::ptrdiff_t random_string_vector_threshold = 1024;
+
+inline unsigned random_string_lowest_bit(std::uint32_t mask)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (unsigned)index;
+#else
+    return (unsigned)__builtin_ctz(mask);
+#endif
+}
+
+// Maps 32 indices below 64 onto the alphabet held 16 characters per table, one pshufb
+// per table blended by the high bits of the index
+inline __m256i random_string_lookup(__m256i indices, const __m256i* tables, std::size_t table_count)
+{
+    __m256i result = _mm256_shuffle_epi8(tables[0], indices);
+    __m256i high = _mm256_and_si256(indices, _mm256_set1_epi8((char)0xF0));
+    for (std::size_t t = 1; t < table_count; t++)
+    {
+        __m256i select = _mm256_cmpeq_epi8(high, _mm256_set1_epi8((char)(t * 16)));
+        result = _mm256_blendv_epi8(result, _mm256_shuffle_epi8(tables[t], indices), select);
+    }
+    return result;
+}
+
+// Random words for the AVX2 kernel, four at a time from any generator
+template <class Generator>
+class random_string_source_avx2
+{
+public:
+    explicit random_string_source_avx2(random_string_bits<Generator>& bits) : bits_(bits) {}
+
+    __m256i next()
+    {
+        alignas(32) std::uint64_t words[4];
+        bits_.fill(words, 4);
+        return _mm256_load_si256((const __m256i*)words);
+    }
+
+private:
+    random_string_bits<Generator>& bits_;
+};
+
+// Four xoshiro256** streams, one per 64-bit lane, seeded from the outputs of a
+// xoshiro256_engine. A single stream is the bottleneck of the kernel, the lanes produce
+// four words for about the price of one.
+class random_string_xoshiro_avx2
+{
+public:
+    explicit random_string_xoshiro_avx2(xoshiro256_engine& engine)
+    {
+        alignas(32) std::uint64_t state[4][4];
+        for (int lane = 0; lane < 4; lane++)
+        {
+            xoshiro256_engine seeded(engine());
+            for (int i = 0; i < 4; i++)
+                state[i][lane] = seeded();
+        }
+        s0_ = _mm256_load_si256((const __m256i*)state[0]);
+        s1_ = _mm256_load_si256((const __m256i*)state[1]);
+        s2_ = _mm256_load_si256((const __m256i*)state[2]);
+        s3_ = _mm256_load_si256((const __m256i*)state[3]);
+    }
+
+    __m256i next()
+    {
+        // rotl(s1 * 5, 7) * 9 with shifts and adds, AVX2 has no 64-bit multiply
+        __m256i times5 = _mm256_add_epi64(_mm256_slli_epi64(s1_, 2), s1_);
+        __m256i rotated = rotl(times5, 7);
+        __m256i result = _mm256_add_epi64(_mm256_slli_epi64(rotated, 3), rotated);
+        __m256i t = _mm256_slli_epi64(s1_, 17);
+        s2_ = _mm256_xor_si256(s2_, s0_);
+        s3_ = _mm256_xor_si256(s3_, s1_);
+        s1_ = _mm256_xor_si256(s1_, s2_);
+        s0_ = _mm256_xor_si256(s0_, s3_);
+        s2_ = _mm256_xor_si256(s2_, t);
+        s3_ = rotl(s3_, 45);
+        return result;
+    }
+
+private:
+    static __m256i rotl(__m256i x, int k)
+    {
+        return _mm256_or_si256(_mm256_slli_epi64(x, k), _mm256_srli_epi64(x, 64 - k));
+    }
+
+private:
+    __m256i s0_;
+    __m256i s1_;
+    __m256i s2_;
+    __m256i s3_;
+};
+
+// Alphabets of up to 64 characters, 32 characters per step. Power of two sizes mask
+// random bytes. Other sizes take Lemire's multiply-shift over 16-bit lanes, which rejects
+// well under one lane in a thousand for these sizes, and the rejected lanes are redrawn
+// one by one afterwards so the result stays exact.
+template <std::size_t Size, class Source, class Generator>
+inline char* random_string_fill_avx2(char* first, char* last, const char* allowed_chars, std::size_t allowed_count, Source& source, random_string_bits<Generator>& bits)
+{
+    if constexpr (Size != 0)
+        allowed_count = Size;
+    alignas(32) char padded[64] = {};
+    std::copy(allowed_chars, allowed_chars + allowed_count, padded);
+    std::size_t table_count = (allowed_count + 15) / 16;
+    __m256i tables[4];
+    for (std::size_t t = 0; t < table_count; t++)
+        tables[t] = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)(padded + t * 16)));
+
+    char* p = first;
+    if ((allowed_count & (allowed_count - 1)) == 0)
+    {
+        __m256i mask = _mm256_set1_epi8((char)(allowed_count - 1));
+        for (; last - p >= 32; p += 32)
+        {
+            __m256i indices = _mm256_and_si256(source.next(), mask);
+            _mm256_storeu_si256((__m256i*)p, random_string_lookup(indices, tables, table_count));
+        }
+        return p;
+    }
+
+    std::uint32_t count = (std::uint32_t)allowed_count;
+    __m256i size = _mm256_set1_epi16((short)count);
+    std::uint32_t threshold = 65536 % count;
+    __m256i limit = _mm256_set1_epi16((short)threshold);
+    for (; last - p >= 32; p += 32)
+    {
+        __m256i random0 = source.next();
+        __m256i random1 = source.next();
+        __m256i low0 = _mm256_mullo_epi16(random0, size);
+        __m256i low1 = _mm256_mullo_epi16(random1, size);
+        // packus interleaves the 128-bit halves, the permute puts the lanes back in order
+        __m256i indices = _mm256_permute4x64_epi64(_mm256_packus_epi16(_mm256_mulhi_epu16(random0, size), _mm256_mulhi_epu16(random1, size)), 0xD8);
+        _mm256_storeu_si256((__m256i*)p, random_string_lookup(indices, tables, table_count));
+
+        // A lane is rejected when its low half is below the threshold, max(low, limit) != low
+        __m256i accepted0 = _mm256_cmpeq_epi16(_mm256_max_epu16(low0, limit), low0);
+        __m256i accepted1 = _mm256_cmpeq_epi16(_mm256_max_epu16(low1, limit), low1);
+        std::uint32_t rejected = ~(std::uint32_t)_mm256_movemask_epi8(_mm256_permute4x64_epi64(_mm256_packs_epi16(accepted0, accepted1), 0xD8));
+        for (; rejected != 0; rejected &= rejected - 1)
+            p[random_string_lowest_bit(rejected)] = allowed_chars[random_string_index<16>(bits, count, threshold)];
+    }
+    return p;
+}
+#endif
+
+template <std::size_t Size, class CharType, class Generator>
+inline void random_string_fill_sized(CharType* first, CharType* last, const CharType* allowed_chars, std::size_t allowed_count, Generator& generator)
+{
+    if constexpr (Size != 0)
+        allowed_count = Size;
+    if (first == last)
+        return;
+    if (allowed_count == 0)
+        throw std::invalid_argument("The allowed characters must not be empty.");
+
+    random_string_bits<Generator> bits(generator);
+#if defined(SAI_CORE_RANDOM_STRING_AVX2)
+    if constexpr (sizeof(CharType) == 1 && Size <= 64)
+    {
+        if (allowed_count <= 64 && last - first >= 32)
+        {
+            if constexpr (std::is_same<std::remove_const_t<Generator>, xoshiro256_engine>::value)
+            {
+                if (last - first >= random_string_vector_threshold)
+                {
+                    random_string_xoshiro_avx2 source(generator);
+                    first = (CharType*)random_string_fill_avx2<Size>((char*)first, (char*)last, (const char*)allowed_chars, allowed_count, source, bits);
+                }
+            }
+            random_string_source_avx2<Generator> source(bits);
+            first = (CharType*)random_string_fill_avx2<Size>((char*)first, (char*)last, (const char*)allowed_chars, allowed_count, source, bits);
+        }
+    }
+#endif
+    random_string_fill_scalar<Size>(first, last, allowed_chars, allowed_count, bits);
+}
+
+// Fills [first, last) with characters drawn uniformly and independently from the
+// allowed_count characters at allowed_chars using the given UniformRandomBitGenerator.
+// Power of two alphabets mask random bytes, others use Lemire's multiply-shift with
+// rejection, so every character is exactly equally likely. With AVX2, char alphabets of
+// up to 64 characters are mapped 32 at a time with pshufb lookups, and long fills from a
+// xoshiro256_engine run four streams seeded from it in parallel. The same seed gives
+// the same string within a build, not across builds with and without AVX2.
+template <class CharType, class Generator, random_string_generator_t<Generator> = 0>
+inline void random_string_fill(CharType* first, CharType* last, const CharType* allowed_chars, std::size_t allowed_count, Generator&& generator)
+{
+    random_string_fill_sized<0>(first, last, allowed_chars, allowed_count, generator);
+}
+
+// Fills [first, last) using the calling thread's fast generator, random_string_engine
+template <class CharType>
+inline void random_string_fill(CharType* first, CharType* last, const CharType* allowed_chars, std::size_t allowed_count)
+{
+    random_string_fill(first, last, allowed_chars, allowed_count, random_string_engine());
+}
+
+// Random string of length characters drawn uniformly from allowed_chars with the given
+// UniformRandomBitGenerator
+template <class StringType, class Traits, class Allocator, class Generator>
+inline auto random_string(const std::basic_string<StringType, Traits, Allocator>& allowed_chars, int length, Generator&& generator)
+{
+    std::basic_string<StringType, Traits, Allocator> random_string(length > 0 ? (std::size_t)length : 0, StringType());
+    random_string_fill(&random_string[0], &random_string[0] + random_string.length(), allowed_chars.data(), allowed_chars.length(), generator);
+    return random_string;
+}
 
+// Uses the calling thread's fast generator, random_string_engine. Not suitable for
+// secrets, use the secure overload for tokens and passwords.
 template <class StringType, class Traits, class Allocator>
 inline auto random_string(const std::basic_string<StringType, Traits, Allocator>& allowed_chars, int length)
 {
-    std::random_device generator;
-    std::uniform_int_distribution<int> distribution(0, (int)(allowed_chars.size() - 1));
-    std::basic_string<StringType, Traits, Allocator> random_string;
-    std::generate_n(std::back_inserter(random_string), length, [&]() { return allowed_chars[distribution(generator)]; });
+    return random_string(allowed_chars, length, random_string_engine());
+}
+
+// Draws from the operating system's secure generator, see secure_random_engine
+template <class StringType, class Traits, class Allocator>
+inline auto random_string(const std::basic_string<StringType, Traits, Allocator>& allowed_chars, int length, secure_t)
+{
+    secure_random_engine generator;
+    return random_string(allowed_chars, length, generator);
+}
+
+// The default alphabet of lowercase letters and digits in each character type
+template <class CharType>
+struct random_string_base36;
+
+template <>
+struct random_string_base36<char>
+{
+    static constexpr std::string_view chars = "abcdefghijklmnopqrstuvwxyz0123456789";
+};
+
+template <>
+struct random_string_base36<wchar_t>
+{
+    static constexpr std::wstring_view chars = L"abcdefghijklmnopqrstuvwxyz0123456789";
+};
+
+template <>
+struct random_string_base36<char16_t>
+{
+    static constexpr std::u16string_view chars = u"abcdefghijklmnopqrstuvwxyz0123456789";
+};
+
+template <>
+struct random_string_base36<char32_t>
+{
+    static constexpr std::u32string_view chars = U"abcdefghijklmnopqrstuvwxyz0123456789";
+};
+
+// Alphabets known at compile time, as in random_string<alphabet::hex>(32). The size is a
+// constant, so the mapping onto the alphabet and its constants are picked at compile time.
+// Any type with a static constexpr string view named chars is an alphabet:
+//
+//     struct dna { static constexpr std::string_view chars = "ACGT"; };
+//     std::string strand = random_string<dna>(100);
+struct alphabet
+{
+    using base36 = random_string_base36<char>;
+
+    struct digits
+    {
+        static constexpr std::string_view chars = "0123456789";
+    };
+
+    struct lowercase
+    {
+        static constexpr std::string_view chars = "abcdefghijklmnopqrstuvwxyz";
+    };
+
+    struct hex
+    {
+        static constexpr std::string_view chars = "0123456789abcdef";
+    };
+
+    struct uppercase_hex
+    {
+        static constexpr std::string_view chars = "0123456789ABCDEF";
+    };
+
+    struct base62
+    {
+        static constexpr std::string_view chars = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+    };
+
+    // The URL and file name safe alphabet of RFC 4648
+    struct base64url
+    {
+        static constexpr std::string_view chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+    };
+};
+
+template <class Alphabet>
+using random_string_char_t = typename std::remove_const_t<decltype(Alphabet::chars)>::value_type;
+
+// Fills [first, last) from the compile-time Alphabet with the given generator
+template <class Alphabet, class Generator, random_string_generator_t<Generator> = 0>
+inline void random_string_fill(random_string_char_t<Alphabet>* first, random_string_char_t<Alphabet>* last, Generator&& generator)
+{
+    static_assert(Alphabet::chars.size() > 0, "An alphabet needs at least one character.");
+    random_string_fill_sized<Alphabet::chars.size()>(first, last, Alphabet::chars.data(), Alphabet::chars.size(), generator);
+}
+
+template <class Alphabet>
+inline void random_string_fill(random_string_char_t<Alphabet>* first, random_string_char_t<Alphabet>* last)
+{
+    random_string_fill<Alphabet>(first, last, random_string_engine());
+}
+
+template <class Alphabet, class Generator, random_string_generator_t<Generator> = 0>
+inline std::basic_string<random_string_char_t<Alphabet>> random_string(int length, Generator&& generator)
+{
+    std::basic_string<random_string_char_t<Alphabet>> random_string(length > 0 ? (std::size_t)length : 0, random_string_char_t<Alphabet>());
+    random_string_fill<Alphabet>(&random_string[0], &random_string[0] + random_string.length(), generator);
     return random_string;
 }
 
+template <class Alphabet>
+inline std::basic_string<random_string_char_t<Alphabet>> random_string(int length)
+{
+    return random_string<Alphabet>(length, random_string_engine());
+}
+
+template <class Alphabet>
+inline std::basic_string<random_string_char_t<Alphabet>> random_string(int length, secure_t)
+{
+    secure_random_engine generator;
+    return random_string<Alphabet>(length, generator);
+}
+
 inline std::string random_string(int length)
 {
-    const std::string allowed_chars = "abcdefghijklmnopqrstuvwxyz0123456789";
-    return random_string(allowed_chars, length);
+    return random_string<alphabet::base36>(length);
+}
+
+template <class Generator>
+inline std::string random_string(int length, Generator&& generator)
+{
+    return random_string<alphabet::base36>(length, std::forward<Generator>(generator));
 }
 
 inline std::wstring random_wstring(int length)
 {
-    const std::wstring allowed_chars = L"abcdefghijklmnopqrstuvwxyz0123456789";
-    return random_string(allowed_chars, length);
+    return random_string<random_string_base36<wchar_t>>(length);
+}
+
+template <class Generator>
+inline std::wstring random_wstring(int length, Generator&& generator)
+{
+    return random_string<random_string_base36<wchar_t>>(length, std::forward<Generator>(generator));
 }
 
 inline std::u16string random_u16string(int length)
 {
-    const std::u16string allowed_chars = u"abcdefghijklmnopqrstuvwxyz0123456789";
-    return random_string(allowed_chars, length);
+    return random_string<random_string_base36<char16_t>>(length);
+}
+
+template <class Generator>
+inline std::u16string random_u16string(int length, Generator&& generator)
+{
+    return random_string<random_string_base36<char16_t>>(length, std::forward<Generator>(generator));
 }
 
 inline std::u32string random_u32string(int length)
 {
-    const std::u32string allowed_chars = U"abcdefghijklmnopqrstuvwxyz0123456789";
-    return random_string(allowed_chars, length);
+    return random_string<random_string_base36<char32_t>>(length);
+}
+
+template <class Generator>
+inline std::u32string random_u32string(int length, Generator&& generator)
+{
+    return random_string<random_string_base36<char32_t>>(length, std::forward<Generator>(generator));
+}
+
+// Characters with relative weights, built once into a Walker/Vose alias table. The table
+// has a power of two number of columns, each holding a threshold, its own character and an
+// alias character. A character takes one 32-bit draw: the low 8 bits pick a column and
+// the high 24 bits are compared with its threshold to choose between the two characters,
+// without branching on the weights. Probabilities are represented to within 2^-24 of
+// a column's share.
+class weighted_alphabet
+{
+public:
+    static constexpr std::size_t max_size = 256;
+    static constexpr std::uint32_t threshold_one = 1u << 24;
+
+    // chars[i] is drawn with probability weights[i] / sum of weights. Weights must be
+    // finite and not negative, with a positive sum. Throws std::invalid_argument.
+    weighted_alphabet(std::string_view chars, const double* weights)
+    {
+        build(chars, weights);
+    }
+
+    weighted_alphabet(std::initializer_list<std::pair<char, double>> weights)
+    {
+        std::string chars;
+        std::vector<double> values;
+        for (const std::pair<char, double>& weight : weights)
+        {
+            chars.push_back(weight.first);
+            values.push_back(weight.second);
+        }
+        build(chars, values.data());
+    }
+
+    std::size_t size() const { return chars_.size(); }
+    std::string_view chars() const { return chars_; }
+    // Number of columns of the table, a power of two at least size()
+    std::size_t columns() const { return thresholds_.size(); }
+    // Column c draws its own character when the 24 coin bits are below thresholds()[c]
+    const std::uint32_t* thresholds() const { return thresholds_.data(); }
+    // Own character of each column in the low byte, alias character in the next
+    const std::uint32_t* pairs() const { return pairs_.data(); }
+
+    // Probability the table gives chars()[index], which is the requested one up to the
+    // rounding of the thresholds
+    double probability(std::size_t index) const
+    {
+        double sum = 0;
+        for (std::size_t c = 0; c < columns(); c++)
+        {
+            if (c == index)
+                sum += (double)thresholds_[c] / threshold_one;
+            if (aliases_[c] == index)
+                sum += 1.0 - (double)thresholds_[c] / threshold_one;
+        }
+        return sum / columns();
+    }
+
+private:
+    void build(std::string_view chars, const double* weights)
+    {
+        std::size_t count = chars.size();
+        if (count == 0 || count > max_size)
+            throw std::invalid_argument("A weighted alphabet needs 1 to 256 characters.");
+        double total = 0;
+        for (std::size_t i = 0; i < count; i++)
+        {
+            if (!std::isfinite(weights[i]) || weights[i] < 0)
+                throw std::invalid_argument("Character weights must be finite and not negative.");
+            total += weights[i];
+        }
+        if (!(total > 0) || !std::isfinite(total))
+            throw std::invalid_argument("Character weights must have a positive sum.");
+
+        std::size_t columns = 1;
+        while (columns < count)
+            columns *= 2;
+
+        // Vose's method: columns below the average are topped up from one above it, which
+        // becomes the alias, until every column is full. Padding columns weigh nothing.
+        std::vector<double> scaled(columns, 0.0);
+        for (std::size_t i = 0; i < count; i++)
+            scaled[i] = weights[i] * (double)columns / total;
+        std::vector<std::size_t> small;
+        std::vector<std::size_t> large;
+        for (std::size_t c = 0; c < columns; c++)
+            (scaled[c] < 1.0 ? small : large).push_back(c);
+
+        chars_.assign(chars.data(), count);
+        thresholds_.assign(columns, threshold_one);
+        aliases_.assign(columns, 0);
+        for (std::size_t c = 0; c < columns; c++)
+            aliases_[c] = (std::uint16_t)(c < count ? c : 0);
+        while (!small.empty() && !large.empty())
+        {
+            std::size_t less = small.back();
+            small.pop_back();
+            std::size_t more = large.back();
+            thresholds_[less] = (std::uint32_t)std::llround(scaled[less] * threshold_one);
+            aliases_[less] = (std::uint16_t)more;
+            scaled[more] -= 1.0 - scaled[less];
+            if (scaled[more] < 1.0)
+            {
+                large.pop_back();
+                small.push_back(more);
+            }
+        }
+        // Columns still listed are full up to rounding and keep their own character
+
+        pairs_.resize(columns);
+        for (std::size_t c = 0; c < columns; c++)
+        {
+            unsigned char own = (unsigned char)chars_[c < count ? c : 0];
+            unsigned char alias = (unsigned char)chars_[aliases_[c]];
+            pairs_[c] = (std::uint32_t)own | ((std::uint32_t)alias << 8);
+        }
+    }
+
+private:
+    std::string chars_;
+    std::vector<std::uint32_t> thresholds_;
+    std::vector<std::uint32_t> pairs_;
+    std::vector<std::uint16_t> aliases_;
+};
+
+template <class Generator>
+inline void random_string_fill_weighted_scalar(char* first, char* last, const weighted_alphabet& weights, Generator& generator)
+{
+    const std::uint32_t* thresholds = weights.thresholds();
+    const std::uint32_t* pairs = weights.pairs();
+    std::uint32_t mask = (std::uint32_t)weights.columns() - 1;
+    std::uint64_t word = 0;
+    unsigned available = 0;
+    for (char* p = first; p != last; p++)
+    {
+        if (available == 0)
+        {
+            word = random_string_word(generator);
+            available = 2;
+        }
+        std::uint32_t random = (std::uint32_t)word;
+        word >>= 32;
+        available--;
+        std::uint32_t column = random & mask;
+        std::uint32_t shift = (random >> 8) < thresholds[column] ? 0 : 8;
+        *p = (char)(pairs[column] >> shift);
+    }
+}
+
+#if defined(SAI_CORE_RANDOM_STRING_AVX2)
+// 32 characters per step as four groups of eight 32-bit lanes, each gathering its
+// column's threshold and character pair
+template <class Source>
+inline char* random_string_fill_weighted_avx2(char* first, char* last, const weighted_alphabet& weights, Source& source)
+{
+    const int* thresholds = (const int*)weights.thresholds();
+    const int* pairs = (const int*)weights.pairs();
+    __m256i mask = _mm256_set1_epi32((int)weights.columns() - 1);
+    __m256i low_byte = _mm256_set1_epi32(0xFF);
+    // The two packs below work within 128-bit halves, this puts the groups back in order
+    __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    char* p = first;
+    for (; last - p >= 32; p += 32)
+    {
+        __m256i groups[4];
+        for (int g = 0; g < 4; g++)
+        {
+            __m256i random = source.next();
+            __m256i column = _mm256_and_si256(random, mask);
+            __m256i coin = _mm256_srli_epi32(random, 8);
+            __m256i threshold = _mm256_i32gather_epi32(thresholds, column, 4);
+            __m256i pair = _mm256_i32gather_epi32(pairs, column, 4);
+            // Thresholds and coins are below 2^25, a signed compare is fine
+            __m256i own = _mm256_cmpgt_epi32(threshold, coin);
+            groups[g] = _mm256_and_si256(_mm256_blendv_epi8(_mm256_srli_epi32(pair, 8), pair, own), low_byte);
+        }
+        __m256i packed = _mm256_packus_epi16(_mm256_packus_epi32(groups[0], groups[1]), _mm256_packus_epi32(groups[2], groups[3]));
+        _mm256_storeu_si256((__m256i*)p, _mm256_permutevar8x32_epi32(packed, order));
+    }
+    return p;
+}
+#endif
+
+// Fills [first, last) with characters drawn from weights with the given generator, through
+// the same vector paths as the uniform fill. Every path follows the same distribution, but
+// long fills from a xoshiro256_engine run four streams seeded from it, so with AVX2 they
+// give different strings than the scalar path for the same seed.
+template <class Generator, random_string_generator_t<Generator> = 0>
+inline void random_string_fill(char* first, char* last, const weighted_alphabet& weights, Generator&& generator)
+{
+    if (first == last)
+        return;
+#if defined(SAI_CORE_RANDOM_STRING_AVX2)
+    if (last - first >= 32)
+    {
+        if constexpr (std::is_same<std::decay_t<Generator>, xoshiro256_engine>::value)
+        {
+            if (last - first >= random_string_vector_threshold)
+            {
+                random_string_xoshiro_avx2 source(generator);
+                first = random_string_fill_weighted_avx2(first, last, weights, source);
+            }
+        }
+        random_string_bits<std::remove_reference_t<Generator>> bits(generator);
+        random_string_source_avx2<std::remove_reference_t<Generator>> source(bits);
+        first = random_string_fill_weighted_avx2(first, last, weights, source);
+    }
+#endif
+    random_string_fill_weighted_scalar(first, last, weights, generator);
+}
+
+inline void random_string_fill(char* first, char* last, const weighted_alphabet& weights)
+{
+    random_string_fill(first, last, weights, random_string_engine());
+}
+
+template <class Generator, random_string_generator_t<Generator> = 0>
+inline std::string random_string(const weighted_alphabet& weights, int length, Generator&& generator)
+{
+    std::string random_string(length > 0 ? (std::size_t)length : 0, '\0');
+    random_string_fill(&random_string[0], &random_string[0] + random_string.length(), weights, generator);
+    return random_string;
+}
+
+inline std::string random_string(const weighted_alphabet& weights, int length)
+{
+    return random_string(weights, length, random_string_engine());
+}
+
+inline std::string random_string(const weighted_alphabet& weights, int length, secure_t)
+{
+    secure_random_engine generator;
+    return random_string(weights, length, generator);
 }
 
 #endif
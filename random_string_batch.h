@@ -0,0 +1,320 @@
+// sai - General purpose self-contained C++ libraries.
+//
+// random_string_batch.h
+// Many random strings of one length generated into a single block of memory.
+// 
+// MIT License
+// 
+// Copyright (c) 2017 Ion Todirel
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#ifndef SAI_CORE_RANDOM_STRING_BATCH_H
+#define SAI_CORE_RANDOM_STRING_BATCH_H
+
+#include "random_string.h"
+#include "parallel_run.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Non-owning view of count strings of length characters stored back to back, string i
+// starts at data() + i * length(). The strings are not null terminated.
+class random_string_view
+{
+public:
+    class const_iterator
+    {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = std::string_view;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const std::string_view*;
+        using reference = std::string_view;
+
+        const_iterator() {}
+        const_iterator(const char* data, std::size_t length, std::size_t index) : data_(data), length_(length), index_(index) {}
+
+        std::string_view operator*() const { return std::string_view(data_ + index_ * length_, length_); }
+
+        const_iterator& operator++()
+        {
+            index_++;
+            return *this;
+        }
+
+        const_iterator operator++(int)
+        {
+            const_iterator previous = *this;
+            index_++;
+            return previous;
+        }
+
+        bool operator == (const const_iterator& other) const { return index_ == other.index_; }
+        bool operator != (const const_iterator& other) const { return index_ != other.index_; }
+
+    private:
+        const char* data_ = nullptr;
+        std::size_t length_ = 0;
+        std::size_t index_ = 0;
+    };
+
+    random_string_view() {}
+    random_string_view(const char* data, std::size_t count, std::size_t length) : data_(data), count_(count), length_(length) {}
+
+    std::size_t size() const { return count_; }
+    bool empty() const { return count_ == 0; }
+    // Length of every string, which is also the stride between them
+    std::size_t length() const { return length_; }
+    const char* data() const { return data_; }
+
+    std::string_view operator[](std::size_t index) const
+    {
+        return std::string_view(data_ + index * length_, length_);
+    }
+
+    std::string_view at(std::size_t index) const
+    {
+        if (index >= count_)
+            throw std::out_of_range("Random string index out of range.");
+        return (*this)[index];
+    }
+
+    const_iterator begin() const { return const_iterator(data_, length_, 0); }
+    const_iterator end() const { return const_iterator(data_, length_, count_); }
+
+private:
+    const char* data_ = nullptr;
+    std::size_t count_ = 0;
+    std::size_t length_ = 0;
+};
+
+// Characters per block of a seeded fill. Block b is always generated by
+// xoshiro256_engine(seed, b) whichever thread gets it, which is what makes the output
+// independent of the thread count.
+constexpr std::size_t random_string_block_size = 1 << 16;
+
+// Splits [first, last) into blocks and spreads them over the threads, calling
+// fill(begin, end, generator) with the block's own xoshiro256_engine
+template <class CharType, class Fill>
+inline void random_string_fill_blocks(CharType* first, CharType* last, std::uint64_t seed, unsigned thread_count, Fill&& fill)
+{
+    std::size_t length = (std::size_t)(last - first);
+    std::size_t block_count = (length + random_string_block_size - 1) / random_string_block_size;
+    thread_count = parallel_thread_count(thread_count);
+    std::size_t chunk_count = thread_count < block_count ? thread_count : block_count;
+    if (chunk_count == 0)
+        chunk_count = 1;
+
+    auto fill_block = [&](std::size_t block)
+    {
+        CharType* begin = first + block * random_string_block_size;
+        CharType* end = length - block * random_string_block_size < random_string_block_size ? last : begin + random_string_block_size;
+        xoshiro256_engine generator(seed, block);
+        fill(begin, end, generator);
+    };
+
+    parallel_run(chunk_count, [&](std::size_t i)
+    {
+        for (std::size_t block = block_count * i / chunk_count; block < block_count * (i + 1) / chunk_count; block++)
+            fill_block(block);
+    });
+}
+
+template <std::size_t Size, class CharType>
+inline void random_string_fill_seeded(CharType* first, CharType* last, const CharType* allowed_chars, std::size_t allowed_count, std::uint64_t seed, unsigned thread_count)
+{
+    // Checked here so the error is reported before any worker starts
+    if (first != last && Size == 0 && allowed_count == 0)
+        throw std::invalid_argument("The allowed characters must not be empty.");
+    random_string_fill_blocks(first, last, seed, thread_count, [&](CharType* begin, CharType* end, xoshiro256_engine& generator)
+    {
+        random_string_fill_sized<Size>(begin, end, allowed_chars, allowed_count, generator);
+    });
+}
+
+// Fills [first, last) from seed across thread_count threads, or one per core if
+// thread_count is 0. The result depends only on the seed and the alphabet, the same seed
+// gives bit-identical output for any thread count, within a build as random_string_fill.
+template <class CharType>
+inline void random_string_fill(CharType* first, CharType* last, const CharType* allowed_chars, std::size_t allowed_count, std::uint64_t seed, unsigned thread_count)
+{
+    random_string_fill_seeded<0>(first, last, allowed_chars, allowed_count, seed, thread_count);
+}
+
+// count random strings of length characters in one allocation, see random_strings
+class random_string_batch
+{
+public:
+    using const_iterator = random_string_view::const_iterator;
+
+    random_string_batch() {}
+
+    // Allocates the block without filling it
+    random_string_batch(std::size_t count, std::size_t length)
+    {
+        if (length != 0 && count > (std::size_t)-1 / length)
+            throw std::length_error("Random string batch too large.");
+        data_.reset(new char[count * length]);
+        view_ = random_string_view(data_.get(), count, length);
+    }
+
+    std::size_t size() const { return view_.size(); }
+    bool empty() const { return view_.empty(); }
+    std::size_t length() const { return view_.length(); }
+    const char* data() const { return data_.get(); }
+    char* data() { return data_.get(); }
+    const random_string_view& view() const { return view_; }
+    operator random_string_view() const { return view_; }
+
+    std::string_view operator[](std::size_t index) const { return view_[index]; }
+    std::string_view at(std::size_t index) const { return view_.at(index); }
+    const_iterator begin() const { return view_.begin(); }
+    const_iterator end() const { return view_.end(); }
+
+private:
+    std::unique_ptr<char[]> data_;
+    random_string_view view_;
+};
+
+// Writes count random strings of length characters from allowed_chars back to back into
+// buffer, which must hold count * length characters, with the given generator
+template <class Generator, random_string_generator_t<Generator> = 0>
+inline random_string_view random_strings(char* buffer, std::size_t count, std::size_t length, std::string_view allowed_chars, Generator&& generator)
+{
+    random_string_fill(buffer, buffer + count * length, allowed_chars.data(), allowed_chars.length(), generator);
+    return random_string_view(buffer, count, length);
+}
+
+inline random_string_view random_strings(char* buffer, std::size_t count, std::size_t length, std::string_view allowed_chars)
+{
+    return random_strings(buffer, count, length, allowed_chars, random_string_engine());
+}
+
+// count random strings of length characters from allowed_chars in a single allocation.
+// The whole block is filled in one pass, so it runs at the speed of random_string_fill
+// rather than paying an allocation and a call per string.
+template <class Generator, random_string_generator_t<Generator> = 0>
+inline random_string_batch random_strings(std::size_t count, std::size_t length, std::string_view allowed_chars, Generator&& generator)
+{
+    random_string_batch batch(count, length);
+    random_strings(batch.data(), count, length, allowed_chars, generator);
+    return batch;
+}
+
+inline random_string_batch random_strings(std::size_t count, std::size_t length, std::string_view allowed_chars)
+{
+    return random_strings(count, length, allowed_chars, random_string_engine());
+}
+
+// Reproducible batch generated from seed across thread_count threads, or one per core if
+// thread_count is 0. The same seed gives the same strings for any thread count, see the
+// seeded random_string_fill.
+inline random_string_view random_strings(char* buffer, std::size_t count, std::size_t length, std::string_view allowed_chars, std::uint64_t seed, unsigned thread_count = 0)
+{
+    random_string_fill(buffer, buffer + count * length, allowed_chars.data(), allowed_chars.length(), seed, thread_count);
+    return random_string_view(buffer, count, length);
+}
+
+inline random_string_batch random_strings(std::size_t count, std::size_t length, std::string_view allowed_chars, std::uint64_t seed, unsigned thread_count = 0)
+{
+    random_string_batch batch(count, length);
+    random_strings(batch.data(), count, length, allowed_chars, seed, thread_count);
+    return batch;
+}
+
+// Batches from a compile-time alphabet, see alphabet in random_string.h
+template <class Alphabet, class Generator, random_string_generator_t<Generator> = 0>
+inline random_string_batch random_strings(std::size_t count, std::size_t length, Generator&& generator)
+{
+    static_assert(sizeof(random_string_char_t<Alphabet>) == 1, "Batches hold narrow characters.");
+    random_string_batch batch(count, length);
+    random_string_fill<Alphabet>(batch.data(), batch.data() + count * length, generator);
+    return batch;
+}
+
+template <class Alphabet>
+inline random_string_batch random_strings(std::size_t count, std::size_t length)
+{
+    return random_strings<Alphabet>(count, length, random_string_engine());
+}
+
+template <class Alphabet>
+inline random_string_batch random_strings(std::size_t count, std::size_t length, std::uint64_t seed, unsigned thread_count = 0)
+{
+    static_assert(sizeof(random_string_char_t<Alphabet>) == 1, "Batches hold narrow characters.");
+    random_string_batch batch(count, length);
+    random_string_fill_seeded<Alphabet::chars.size()>(batch.data(), batch.data() + count * length, Alphabet::chars.data(), Alphabet::chars.size(), seed, thread_count);
+    return batch;
+}
+
+// Batches of characters drawn from a weighted_alphabet, in the same ways as above
+template <class Generator, random_string_generator_t<Generator> = 0>
+inline random_string_view random_strings(char* buffer, std::size_t count, std::size_t length, const weighted_alphabet& weights, Generator&& generator)
+{
+    random_string_fill(buffer, buffer + count * length, weights, generator);
+    return random_string_view(buffer, count, length);
+}
+
+inline random_string_view random_strings(char* buffer, std::size_t count, std::size_t length, const weighted_alphabet& weights)
+{
+    return random_strings(buffer, count, length, weights, random_string_engine());
+}
+
+inline random_string_view random_strings(char* buffer, std::size_t count, std::size_t length, const weighted_alphabet& weights, std::uint64_t seed, unsigned thread_count = 0)
+{
+    random_string_fill_blocks(buffer, buffer + count * length, seed, thread_count, [&](char* begin, char* end, xoshiro256_engine& generator)
+    {
+        random_string_fill(begin, end, weights, generator);
+    });
+    return random_string_view(buffer, count, length);
+}
+
+template <class Generator, random_string_generator_t<Generator> = 0>
+inline random_string_batch random_strings(std::size_t count, std::size_t length, const weighted_alphabet& weights, Generator&& generator)
+{
+    random_string_batch batch(count, length);
+    random_strings(batch.data(), count, length, weights, generator);
+    return batch;
+}
+
+inline random_string_batch random_strings(std::size_t count, std::size_t length, const weighted_alphabet& weights)
+{
+    return random_strings(count, length, weights, random_string_engine());
+}
+
+inline random_string_batch random_strings(std::size_t count, std::size_t length, const weighted_alphabet& weights, std::uint64_t seed, unsigned thread_count = 0)
+{
+    random_string_batch batch(count, length);
+    random_strings(batch.data(), count, length, weights, seed, thread_count);
+    return batch;
+}
+
+// Lowercase letters and digits, like random_string(length)
+inline random_string_batch random_strings(std::size_t count, std::size_t length)
+{
+    return random_strings<alphabet::base36>(count, length);
+}
+
+#endif
@@ -0,0 +1,128 @@
+// sai - General purpose self-contained C++ libraries.
+//
+// system_random.h
+// Operating system entropy with per thread buffering and fork detection.
+// 
+// MIT License
+// 
+// Copyright (c) 2017 Ion Todirel
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef SAI_CORE_SYSTEM_RANDOM_H
+#define SAI_CORE_SYSTEM_RANDOM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <memory>
+#include <system_error>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#include <bcrypt.h>
+#pragma comment(lib, "bcrypt.lib")
+#elif defined(__APPLE__)
+#include <stdlib.h>
+#include <pthread.h>
+#else
+#include <cerrno>
+#include <pthread.h>
+#include <sys/random.h>
+#endif
+
+// Fills buffer with bytes from the operating system's cryptographically secure generator,
+// BCryptGenRandom, arc4random or getrandom
+inline void system_random_fill(void* buffer, std::size_t size)
+{
+#if defined(_WIN32)
+    // BCryptGenRandom reports failures through the returned NTSTATUS, not the last error
+    NTSTATUS status = BCryptGenRandom(nullptr, (PUCHAR)buffer, (ULONG)size, BCRYPT_USE_SYSTEM_PREFERRED_RNG);
+    if (!BCRYPT_SUCCESS(status))
+    {
+        char message[] = "BCryptGenRandom failed with status 0x00000000.";
+        for (int i = 0; i < 8; i++)
+            message[sizeof(message) - 3 - i] = "0123456789ABCDEF"[((unsigned long)status >> (i * 4)) & 0xF];
+        throw std::system_error(std::error_code((int)status, std::system_category()), message);
+    }
+#elif defined(__APPLE__)
+    arc4random_buf(buffer, size);
+#else
+    unsigned char* p = (unsigned char*)buffer;
+    while (size > 0)
+    {
+        ssize_t n = getrandom(p, size, 0);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            throw std::system_error(std::error_code(errno, std::system_category()), "getrandom failed.");
+        }
+        p += n;
+        size -= (std::size_t)n;
+    }
+#endif
+}
+
+inline std::atomic<unsigned>& system_fork_counter()
+{
+    static std::atomic<unsigned> counter(0);
+    return counter;
+}
+
+// Number of forks that led to this process. A forked child inherits the parent's
+// memory, state derived from entropy records the generation it was made in and is
+// discarded when the generation changes, so parent and child never share it.
+inline unsigned system_fork_generation()
+{
+#if defined(_WIN32)
+    return 0;
+#else
+    static const bool registered = pthread_atfork(nullptr, nullptr, []() { system_fork_counter().fetch_add(1, std::memory_order_relaxed); }) == 0;
+    (void)registered;
+    return system_fork_counter().load(std::memory_order_relaxed);
+#endif
+}
+
+// Next 64-bit word of the calling thread's block of WordCount words from
+// system_random_fill. The block is refilled once used up, or after a fork.
+template <std::size_t WordCount>
+inline std::uint64_t system_random_word()
+{
+    struct entropy_block
+    {
+        std::unique_ptr<std::uint64_t[]> words;
+        std::size_t position = WordCount;
+        unsigned generation = 0;
+    };
+
+    thread_local entropy_block block;
+    unsigned generation = system_fork_generation();
+    if (block.position == WordCount || block.generation != generation)
+    {
+        if (!block.words)
+            block.words.reset(new std::uint64_t[WordCount]);
+        system_random_fill(block.words.get(), WordCount * sizeof(std::uint64_t));
+        block.position = 0;
+        block.generation = generation;
+    }
+    return block.words[block.position++];
+}
+
+#endif
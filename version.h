@@ -29,164 +29,451 @@
 #define SAI_CORE_VERSION_H
 
 #include <string>
+#include <string_view>
 #include <stdexcept>
-#include <sstream>
+#include <system_error>
+#include <charconv>
+#include <cstring>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
 
 class version_parse_exception : public std::exception
 {
 public:
     version_parse_exception() : std::exception() {}
-    version_parse_exception(const std::string& message) : std::exception(message.c_str()) { message_ = message; }
+    version_parse_exception(const std::string& message) : message_(message) {}
+    version_parse_exception(const std::string& message, std::size_t position) : message_(message), position_(position) {}
 
-    std::string message() { return message_; }
+    std::string message() const { return message_; }
+    // Offset of the first character that could not be parsed
+    std::size_t position() const { return position_; }
+
+    const char* what() const noexcept override { return message_.c_str(); }
 
 private:
     std::string message_;
+    std::size_t position_ = 0;
 };
 
-class version
+// Result of version::from_chars, ptr is last on success or points at the first
+// offending character on failure
+struct version_from_chars_result
+{
+    const char* ptr;
+    std::errc ec;
+};
+
+// Result of version::to_chars, ptr is one past the last character written on success,
+// on failure ec is value_too_large and ptr is last
+struct version_to_chars_result
+{
+    char* ptr;
+    std::errc ec;
+};
+
+// Process wide table of release tags. Each distinct tag is stored once and named by a
+// 32-bit handle, so versions carry a handle instead of a string. Handle 0 is the empty
+// tag and the well known tags below have fixed handles, 1 for alpha and so on, which
+// are valid before anything is interned. Looking up the text of a handle is lock-free,
+// interning a tag takes a shared lock unless it is new. Tags are never removed.
+class version_release_pool
 {
 public:
-    static version parse(const std::string& version_string)
-    {
-        return parse(version_string, "-");
-    }
+    static constexpr std::uint32_t max_size = 1u << 24;
+
+    static constexpr std::string_view well_known_tags[] = {
+        "", "alpha", "beta", "rc", "rc1", "rc2", "rc3", "rc4", "rc5", "rc6", "rc7", "rc8", "rc9",
+        "pre", "preview", "dev", "snapshot", "SNAPSHOT", "nightly", "canary", "rtm", "ga", "final", "release", "stable"
+    };
+    static constexpr std::uint32_t well_known_count = sizeof(well_known_tags) / sizeof(well_known_tags[0]);
 
-    static version parse(const std::string& version_string, const std::string& release_separator)
+    // Handle of a well known tag, or max_size if the tag is not one of them
+    static constexpr std::uint32_t well_known_handle(std::string_view tag)
     {
-        version v;
-        if (!try_parse(version_string, release_separator, v))
+        for (std::uint32_t i = 0; i < well_known_count; i++)
         {
-            throw version_parse_exception("Could not parse version.");
+            if (well_known_tags[i] == tag)
+                return i;
         }
-        return v;
+        return max_size;
     }
 
-    static bool try_parse(const std::string& version_string, version& result) noexcept
+    // The pool used by version
+    static version_release_pool& instance()
     {
-        return try_parse(version_string, "-", result);
+        static version_release_pool pool;
+        return pool;
     }
 
-    static bool try_parse(const std::string& version_string, const std::string& release_separator, version& result) noexcept
+    version_release_pool() : id_(next_id().fetch_add(1, std::memory_order_relaxed))
     {
-        version v;
+        for (std::uint32_t i = 0; i < well_known_count; i++)
+            add(well_known_tags[i]);
+    }
 
-        if (version_string.length() == 0)
+    version_release_pool(const version_release_pool&) = delete;
+    version_release_pool& operator=(const version_release_pool&) = delete;
+
+    ~version_release_pool()
+    {
+        for (std::atomic<std::string_view*>& segment : segments_)
+            delete[] segment.load(std::memory_order_relaxed);
+    }
+
+    // Handle of tag, adding it to the pool if needed, throws std::length_error if the pool is full
+    std::uint32_t intern(std::string_view tag)
+    {
+        std::uint32_t handle = 0;
+        if (!try_intern(tag, handle))
+            throw std::length_error("Version release pool is full.");
+        return handle;
+    }
+
+    bool try_intern(std::string_view tag, std::uint32_t& handle)
+    {
+        // Bulk parsing sees the same few tags over and over, a small per-thread cache
+        // answers those without touching the shared lock
+        thread_local cache_entry cache[cache_size];
+        cache_entry& cached = cache[cache_index(tag)];
+        if (cached.pool == id_ && cached.tag == tag)
         {
-            return false;
+            handle = cached.handle;
+            return true;
         }
 
-        int i = 0;
-        std::stringstream ss(version_string);
-        std::string s;
-        while (std::getline(ss, s, '.'))
+        handle = well_known_handle(tag);
+        if (handle == max_size && !find_or_add(tag, handle))
+            return false;
+        cached.pool = id_;
+        cached.tag = this->tag(handle);
+        cached.handle = handle;
+        return true;
+    }
+
+    // Handle of tag if it was interned
+    bool try_find(std::string_view tag, std::uint32_t& handle) const
+    {
+        handle = well_known_handle(tag);
+        if (handle != max_size)
+            return true;
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        auto it = handles_.find(tag);
+        if (it == handles_.end())
+            return false;
+        handle = it->second;
+        return true;
+    }
+
+    // Text of a handle returned by this pool, valid for the lifetime of the pool
+    std::string_view tag(std::uint32_t handle) const
+    {
+        return segments_[handle / segment_size].load(std::memory_order_acquire)[handle % segment_size];
+    }
+
+    std::size_t size() const { return size_.load(std::memory_order_acquire); }
+
+private:
+    static constexpr std::uint32_t segment_size = 4096;
+    static constexpr std::size_t cache_size = 64;
+
+    struct cache_entry
+    {
+        std::uint64_t pool = 0;
+        std::string_view tag;
+        std::uint32_t handle = 0;
+    };
+
+    static std::size_t cache_index(std::string_view tag)
+    {
+        std::size_t h = tag.length();
+        for (char ch : tag)
+            h = h * 31 + (unsigned char)ch;
+        return h % cache_size;
+    }
+
+    // Identifies the pool in the thread caches, ids are never reused so a cache entry
+    // cannot outlive its pool and match a new one
+    static std::atomic<std::uint64_t>& next_id()
+    {
+        static std::atomic<std::uint64_t> id(1);
+        return id;
+    }
+
+    bool find_or_add(std::string_view tag, std::uint32_t& handle)
+    {
         {
-            size_t release_index = s.find(release_separator);
-            if (release_index != s.npos)
+            std::shared_lock<std::shared_mutex> lock(mutex_);
+            auto it = handles_.find(tag);
+            if (it != handles_.end())
             {
-                v.release_ = s.substr(release_index + release_separator.length());
-                v.release_set_ = true;
-                if (v.seq_field_count_ == 4)
-                {
-                    v.seq_field_count_++;
-                }
-                s = s.substr(0, release_index);
+                handle = it->second;
+                return true;
             }
+        }
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        auto it = handles_.find(tag);
+        if (it != handles_.end())
+        {
+            handle = it->second;
+            return true;
+        }
+        if (size_.load(std::memory_order_relaxed) == max_size)
+            return false;
+        handle = add(tag);
+        return true;
+    }
 
-            int n = 0;
-            try
-            {
-                n = std::stoi(s);
-            }
-            catch (std::invalid_argument&)
-            {
-                return false;
-            }
-            catch (std::out_of_range&)
+    static constexpr std::size_t text_block_size = 64 * 1024;
+
+    // Copies the tag into the pool, called with the lock held or from the constructor
+    std::uint32_t add(std::string_view tag)
+    {
+        // The empty tag is interned by the constructor before any text block exists
+        std::string_view stored;
+        if (!tag.empty())
+        {
+            if (tag.length() > text_remaining_)
             {
-                return false;
+                std::size_t size = tag.length() > text_block_size ? tag.length() : text_block_size;
+                text_blocks_.emplace_back(new char[size]);
+                text_position_ = text_blocks_.back().get();
+                text_remaining_ = size;
             }
+            std::memcpy(text_position_, tag.data(), tag.length());
+            stored = std::string_view(text_position_, tag.length());
+            text_position_ += tag.length();
+            text_remaining_ -= tag.length();
+        }
 
-            if (i == 0)
-                v.major_ = n;
-            else if (i == 1)
-                v.minor_ = n;
-            else if (i == 2)
+        std::uint32_t handle = (std::uint32_t)size_.load(std::memory_order_relaxed);
+        std::string_view* segment = segments_[handle / segment_size].load(std::memory_order_relaxed);
+        if (segment == nullptr)
+        {
+            segment = new std::string_view[segment_size];
+            segments_[handle / segment_size].store(segment, std::memory_order_release);
+        }
+        segment[handle % segment_size] = stored;
+        handles_.emplace(stored, handle);
+        size_.store(handle + 1, std::memory_order_release);
+        return handle;
+    }
+
+    // Segments are never moved once published, so readers need no lock
+    std::atomic<std::string_view*> segments_[max_size / segment_size] = {};
+    std::atomic<std::size_t> size_{ 0 };
+    std::unordered_map<std::string_view, std::uint32_t> handles_;
+    std::vector<std::unique_ptr<char[]>> text_blocks_;
+    char* text_position_ = nullptr;
+    std::size_t text_remaining_ = 0;
+    mutable std::shared_mutex mutex_;
+    std::uint64_t id_;
+};
+
+class version
+{
+public:
+    // Largest values of the numeric fields, they are bounded so key() fits in 64 bits
+    static constexpr int max_major = 32767;
+    static constexpr int max_field = 65535;
+    // Length of the longest numeric part, 32767.65535.65535.65535
+    static constexpr std::size_t max_numeric_chars = 23;
+    // Release handle of versions without a release tag, see release_handle
+    static constexpr std::uint32_t no_release = 0xFFFFFFFF;
+
+    // Parser usable in constant expressions, behind the _ver literal. Release tags must be
+    // one of version_release_pool::well_known_tags since nothing can be interned at compile
+    // time. Throws version_parse_exception, which fails compilation in a constant expression.
+    static constexpr version parse_constant(std::string_view text)
+    {
+        int numbers[4] = {};
+        int count = 0;
+        std::size_t i = 0;
+        for (;;)
+        {
+            if (i == text.length() || text[i] < '0' || text[i] > '9')
+                throw version_parse_exception("Could not parse version literal.", i);
+            std::size_t start = i;
+            int number = 0;
+            for (; i < text.length() && text[i] >= '0' && text[i] <= '9'; i++)
             {
-                v.revision_ = n;
-                v.seq_field_count_++;
+                number = number * 10 + (text[i] - '0');
+                if (number > (count == 0 ? max_major : max_field))
+                    throw version_parse_exception("Version literal field out of range.", start);
             }
-            else if (i == 3)
+            numbers[count++] = number;
+
+            if (i == text.length())
+                return version(numbers[0], numbers[1], numbers[2], numbers[3], count < 2 ? 2 : count, no_release);
+            if (text[i] == '.' && count < 4)
             {
-                v.build_ = n;
-                v.seq_field_count_++;
+                i++;
+                continue;
             }
+            if (text[i] != '-')
+                throw version_parse_exception("Could not parse version literal.", i);
+            std::uint32_t handle = version_release_pool::well_known_handle(text.substr(i + 1));
+            if (handle == version_release_pool::max_size)
+                throw version_parse_exception("Version literal release tag is not a well known tag.", i + 1);
+            return version(numbers[0], numbers[1], numbers[2], numbers[3], count < 2 ? 2 : count, handle);
+        }
+    }
+
+    static version parse(std::string_view version_string)
+    {
+        return parse(version_string, "-");
+    }
 
-            i++;
+    static version parse(std::string_view version_string, std::string_view release_separator)
+    {
+        version v;
+        version_from_chars_result result = from_chars(version_string.data(), version_string.data() + version_string.size(), v, release_separator);
+        if (result.ec != std::errc())
+        {
+            std::size_t position = (std::size_t)(result.ptr - version_string.data());
+            throw version_parse_exception("Could not parse version, unexpected character at position " + std::to_string(position) + ".", position);
         }
+        return v;
+    }
 
-        // Only assign if successful
-        result = v;
+    static bool try_parse(std::string_view version_string, version& result) noexcept
+    {
+        return try_parse(version_string, "-", result);
+    }
 
-        return true;
+    static bool try_parse(std::string_view version_string, std::string_view release_separator, version& result) noexcept
+    {
+        return from_chars(version_string.data(), version_string.data() + version_string.size(), result, release_separator).ec == std::errc();
+    }
+
+    // Parses major[.minor[.revision[.build]]][<separator>release] from the whole of
+    // [first, last) in a single pass. The release tag is interned in
+    // version_release_pool, which only allocates for tags it has not seen and fails
+    // with value_too_large when full. result is only assigned on success.
+    static version_from_chars_result from_chars(const char* first, const char* last, version& result, std::string_view release_separator = "-") noexcept
+    {
+        int numbers[4] = {};
+        int count = 0;
+        const char* p = first;
+        for (;;)
+        {
+            // from_chars would take a leading minus sign, fields are unsigned
+            if (p == last || *p < '0' || *p > '9')
+                return { p, std::errc::invalid_argument };
+            std::from_chars_result number = std::from_chars(p, last, numbers[count]);
+            if (number.ec != std::errc())
+                return { p, number.ec };
+            if (numbers[count] > (count == 0 ? max_major : max_field))
+                return { p, std::errc::result_out_of_range };
+            p = number.ptr;
+            count++;
+
+            if (p == last)
+                break;
+            if (*p == '.' && count < 4)
+            {
+                p++;
+                continue;
+            }
+            if (!release_separator.empty() && (std::size_t)(last - p) >= release_separator.length() &&
+                std::memcmp(p, release_separator.data(), release_separator.length()) == 0)
+                break;
+            return { p, std::errc::invalid_argument };
+        }
+
+        const char* release = p == last ? last : p + release_separator.length();
+        std::uint32_t handle = 0;
+        if (p != last && !version_release_pool::instance().try_intern(std::string_view(release, (std::size_t)(last - release)), handle))
+            return { release, std::errc::value_too_large };
+
+        result = version();
+        result.major_ = (std::uint16_t)numbers[0];
+        result.minor_ = (std::uint16_t)numbers[1];
+        result.revision_ = (std::uint16_t)numbers[2];
+        result.build_ = (std::uint16_t)numbers[3];
+        result.flags_ = (std::uint8_t)(count < 2 ? 2 : count);
+        if (p != last)
+        {
+            result.release_ = handle;
+            result.flags_ |= release_flag;
+        }
+        return { last, std::errc() };
     }
 
-    version() {}
-    explicit version(const std::string& version_string) { *this = parse(version_string); }
-    version(int major, int minor) : major_(major), minor_(minor) {}
-    version(int major, int minor, const std::string& release) : major_(major), minor_(minor), release_(release), seq_field_count_(2), release_set_(true) {}
-    version(int major, int minor, int revision) : major_(major), minor_(minor), revision_(revision), seq_field_count_(3) {}
-    version(int major, int minor, int revision, const std::string& release) : major_(major), minor_(minor), revision_(revision), seq_field_count_(3), release_(release), release_set_(true) {}
-    version(int major, int minor, int revision, int build) : major_(major), minor_(minor), revision_(revision), build_(build), seq_field_count_(4) {}
-    version(int major, int minor, int revision, int build, const std::string& release) : major_(major), minor_(minor), revision_(revision), build_(build), release_(release), seq_field_count_(5), release_set_(true) {}
+    constexpr version() {}
+    explicit version(std::string_view version_string) { *this = parse(version_string); }
+    // The constructors throw std::out_of_range for negative fields or fields above max_major and max_field
+    constexpr version(int major, int minor) : minor_(checked(minor, max_field)), major_(checked(major, max_major)) {}
+    version(int major, int minor, std::string_view release) : minor_(checked(minor, max_field)), major_(checked(major, max_major)), flags_(2) { assign_release(release); }
+    constexpr version(int major, int minor, int revision) : revision_(checked(revision, max_field)), minor_(checked(minor, max_field)), major_(checked(major, max_major)), flags_(3) {}
+    version(int major, int minor, int revision, std::string_view release) : revision_(checked(revision, max_field)), minor_(checked(minor, max_field)), major_(checked(major, max_major)), flags_(3) { assign_release(release); }
+    constexpr version(int major, int minor, int revision, int build) : build_(checked(build, max_field)), revision_(checked(revision, max_field)), minor_(checked(minor, max_field)), major_(checked(major, max_major)), flags_(4) {}
+    version(int major, int minor, int revision, int build, std::string_view release) : build_(checked(build, max_field)), revision_(checked(revision, max_field)), minor_(checked(minor, max_field)), major_(checked(major, max_major)), flags_(5) { assign_release(release); }
+
+    // Rebuilds a version from its parts, as stored in columns by version_table. field_count
+    // is the number of numeric fields, 2 to 4, and release_handle a handle from
+    // version_release_pool or no_release.
+    constexpr version(int major, int minor, int revision, int build, int field_count, std::uint32_t release_handle) : build_(checked(build, max_field)), revision_(checked(revision, max_field)), minor_(checked(minor, max_field)), major_(checked(major, max_major))
+    {
+        if (field_count < 2 || field_count > 4)
+            throw std::out_of_range("Version field count out of range.");
+        flags_ = (std::uint8_t)field_count;
+        if (release_handle != no_release)
+        {
+            release_ = release_handle;
+            flags_ |= release_flag;
+        }
+    }
 
     void swap(version& other)
     {
         std::swap(*this, other);
     }
 
-    int major() const { return major_; }
-    int minor() const { return minor_; }
-    int revision() const { return revision_; }
-    int build() const { return build_; }
-    std::string release() const { return release_; }
+    constexpr int major() const { return major_; }
+    constexpr int minor() const { return minor_; }
+    constexpr int revision() const { return revision_; }
+    constexpr int build() const { return build_; }
+    std::string_view release() const { return version_release_pool::instance().tag(release_); }
+    // Handle of the release tag in version_release_pool, equal tags have equal handles,
+    // no_release if the version has no release tag
+    constexpr std::uint32_t release_handle() const { return release_set() ? release_ : no_release; }
 
-    int fields() const
+    constexpr int fields() const
     {
-        return (seq_field_count_ < 5 && release_set_) ? seq_field_count_ + 1 : seq_field_count_;
+        return (seq_field_count() < 5 && release_set()) ? seq_field_count() + 1 : seq_field_count();
     }
 
-    bool empty() const
+    constexpr bool empty() const
     {
         return major_ == 0 &&
             minor_ == 0 &&
             revision_ == 0 &&
             build_ == 0 &&
-            release_.length() == 0 &&
-            seq_field_count_ == 2 &&
-            release_set_ == false;
+            release_ == 0 &&
+            flags_ == 2;
     }
 
     void clear()
     {
-        major_ = {};
-        minor_ = {};
-        revision_ = {};
-        build_ = {};
-        release_ = {};
-        seq_field_count_ = 2;
-        release_set_ = false;
+        *this = version();
     }
 
     std::string to_string() const
     {
-        return to_string(seq_field_count_);
+        return to_string(seq_field_count());
     }
 
     std::string to_string(int field_count) const
     {
-        return to_string(seq_field_count_, release_set_);
+        return to_string(field_count, release_set());
     }
 
     std::string to_string(int field_count, bool include_release) const
@@ -196,64 +483,99 @@ public:
 
     std::string to_string(int field_count, bool include_release, const std::string& release_separator) const
     {
-        return to_string(field_count, include_release, release_separator.c_str());
+        return to_string(field_count, include_release, std::string_view(release_separator));
     }
 
     std::string to_string(int field_count, bool include_release, const char* release_separator) const
     {
-        std::string str = std::to_string(major_) + "." + std::to_string(minor_);
-        if (field_count >= 3)
-            str += "." + std::to_string(revision_);
-        if (field_count >= 4)
-            str += "." + std::to_string(build_);
-        if ((field_count >= 5 && release_.length() > 0) || include_release)
-            str += release_separator + release_;
+        return to_string(field_count, include_release, std::string_view(release_separator));
+    }
+
+    std::string to_string(int field_count, bool include_release, std::string_view release_separator) const
+    {
+        std::string str(max_numeric_chars + release_separator.length() + release().length(), '\0');
+        str.resize((std::size_t)(to_chars(&str[0], &str[0] + str.length(), field_count, include_release, release_separator).ptr - str.data()));
         return str;
     }
 
-    bool operator==(const version& other) const { return compare(other) == 0; }
-    bool operator!=(const version& other) const { return compare(other) == -1; }
-    bool operator<(const version& other) const { return compare(other) < 0; }
-    bool operator>(const version& other) const { return compare(other) > 0; }
-    bool operator<=(const version& other) const { return compare(other) <= 0; }
-    bool operator>=(const version& other) const { return compare(other) >= 0; }
+    // Writes the version as to_string() does into [first, last) without allocating
+    version_to_chars_result to_chars(char* first, char* last) const noexcept
+    {
+        return to_chars(first, last, seq_field_count(), true, "-");
+    }
 
-    int compare(const version& other) const
+    // Writes field_count numeric fields, 2 to 4, followed by the separator and the release
+    // tag when the version has one and include_release is set or field_count is 5. Nothing
+    // past the numeric part is guaranteed to be written when the buffer is too small.
+    version_to_chars_result to_chars(char* first, char* last, int field_count, bool include_release = true, std::string_view release_separator = "-") const noexcept
     {
-        if (major_ != other.major_)
+        int numeric = field_count < 2 ? 2 : (field_count > 4 ? 4 : field_count);
+        const std::uint16_t numbers[4] = { major_, minor_, revision_, build_ };
+        char* p = first;
+        for (int i = 0; i < numeric; i++)
         {
-            if (major_ < other.major_)
-                return -1;
-            return 1;
+            if (i > 0)
+            {
+                if (p == last)
+                    return { last, std::errc::value_too_large };
+                *p++ = '.';
+            }
+            std::to_chars_result number = std::to_chars(p, last, numbers[i]);
+            if (number.ec != std::errc())
+                return { last, std::errc::value_too_large };
+            p = number.ptr;
         }
 
-        if (minor_ != other.minor_)
+        if (release_set() && (include_release || field_count >= 5))
         {
-            if (minor_ < other.minor_)
-                return -1;
-            return 1;
+            std::string_view tag = release();
+            if ((std::size_t)(last - p) < release_separator.length() + tag.length())
+                return { last, std::errc::value_too_large };
+            std::memcpy(p, release_separator.data(), release_separator.length());
+            p += release_separator.length();
+            std::memcpy(p, tag.data(), tag.length());
+            p += tag.length();
         }
+        return { p, std::errc() };
+    }
 
-        if (revision_ != other.revision_)
-        {
-            if (revision_ < other.revision_)
-                return -1;
-            return 1;
-        }
+    // Order preserving packing of the version, major:15 minor:16 revision:16 build:16
+    // and a final bit set when a release tag is present, so 1.0 < 1.0-rtm < 1.1.
+    // Release tags themselves do not take part in comparisons.
+    constexpr std::uint64_t key() const
+    {
+        // Written as one 64-bit word shifted by one so compilers can load the four fields,
+        // stored from build_ up to major_, with a single instruction on little endian targets
+        return ((((std::uint64_t)major_ << 48) | ((std::uint64_t)minor_ << 32) | ((std::uint64_t)revision_ << 16) | (std::uint64_t)build_) << 1) | (release_set() ? 1u : 0u);
+    }
 
-        if (build_ != other.build_)
-        {
-            if (build_ < other.build_)
-                return -1;
-            return 1;
-        }
+    // Key of the version with the given fields, which must be within range
+    static constexpr std::uint64_t pack(int major, int minor, int revision, int build, bool release)
+    {
+        return ((std::uint64_t)major << 49) | ((std::uint64_t)minor << 33) | ((std::uint64_t)revision << 17) | ((std::uint64_t)build << 1) | (release ? 1u : 0u);
+    }
 
-        if (release_set_ != other.release_set_ && release_ != other.release_)
-        {
-            return -1;
-        }
+    constexpr std::size_t hash() const
+    {
+        std::uint64_t h = key() * 0x9E3779B97F4A7C15ull;
+        h ^= h >> 32;
+        h *= 0xD6E8FEB86659FD93ull;
+        h ^= h >> 32;
+        return (std::size_t)h;
+    }
+
+    constexpr bool operator==(const version& other) const { return key() == other.key(); }
+    constexpr bool operator!=(const version& other) const { return key() != other.key(); }
+    constexpr bool operator<(const version& other) const { return key() < other.key(); }
+    constexpr bool operator>(const version& other) const { return key() > other.key(); }
+    constexpr bool operator<=(const version& other) const { return key() <= other.key(); }
+    constexpr bool operator>=(const version& other) const { return key() >= other.key(); }
 
-        return 0;
+    constexpr int compare(const version& other) const
+    {
+        std::uint64_t a = key();
+        std::uint64_t b = other.key();
+        return a < b ? -1 : (a > b ? 1 : 0);
     }
 
     version& operator++()
@@ -284,46 +606,47 @@ public:
 
     version& operator+=(const version& other)
     {
-        major_ += other.major_;
-        minor_ += other.minor_;
-        revision_ += other.revision_;
-        build_ += other.build_;
-        seq_field_count_ = std::max(seq_field_count_, other.seq_field_count_);
-        if (!release_set_ && other.seq_field_count_ > 4)
+        major_ = clamped((long long)major_ + other.major_, max_major);
+        minor_ = clamped((long long)minor_ + other.minor_, max_field);
+        revision_ = clamped((long long)revision_ + other.revision_, max_field);
+        build_ = clamped((long long)build_ + other.build_, max_field);
+        int count = std::max(seq_field_count(), other.seq_field_count());
+        if (!release_set() && other.seq_field_count() > 4)
         {
-            seq_field_count_--;
+            count--;
         }
+        flags_ = (std::uint8_t)((flags_ & release_flag) | count);
         return *this;
     }
 
     version& operator-=(const version& other)
     {
-        major_ = std::max(major_ - other.major_, 0);
-        minor_ = std::max(minor_ - other.minor_, 0);
-        revision_ = std::max(revision_ - other.revision_, 0);
-        build_ = std::max(build_ - other.build_, 0);
+        major_ = clamped((long long)major_ - other.major_, max_major);
+        minor_ = clamped((long long)minor_ - other.minor_, max_field);
+        revision_ = clamped((long long)revision_ - other.revision_, max_field);
+        build_ = clamped((long long)build_ - other.build_, max_field);
         return *this;
     }
 
     version& operator+=(int value)
     {
-        if (seq_field_count_ == 2)
-            minor_ += value;
-        else if (seq_field_count_ == 3)
-            revision_ += value;
-        else if (seq_field_count_ >= 4)
-            build_ += value;
+        if (seq_field_count() == 2)
+            minor_ = clamped((long long)minor_ + value, max_field);
+        else if (seq_field_count() == 3)
+            revision_ = clamped((long long)revision_ + value, max_field);
+        else if (seq_field_count() >= 4)
+            build_ = clamped((long long)build_ + value, max_field);
         return *this;
     }
 
     version& operator-=(int value)
     {
-        if (seq_field_count_ == 2)
-            minor_ = std::max(minor_ - value, 0);
-        else if (seq_field_count_ == 3)
-            revision_ = std::max(revision_ - value, 0);
-        else if (seq_field_count_ >= 4)
-            build_ = std::max(build_ - value, 0);
+        if (seq_field_count() == 2)
+            minor_ = clamped((long long)minor_ - value, max_field);
+        else if (seq_field_count() == 3)
+            revision_ = clamped((long long)revision_ - value, max_field);
+        else if (seq_field_count() >= 4)
+            build_ = clamped((long long)build_ - value, max_field);
         return *this;
     }
 
@@ -356,13 +679,61 @@ public:
     }
 
 private:
-    int major_ = 0;
-    int minor_ = 0;
-    int revision_ = 0;
-    int build_ = 0;
-    std::string release_;
-    int seq_field_count_ = 2;
-    bool release_set_ = false;
+    // Set in flags_ when a release tag is present, even an empty one
+    static constexpr std::uint8_t release_flag = 0x08;
+
+    static constexpr std::uint16_t checked(int value, int max)
+    {
+        if (value < 0 || value > max)
+            throw std::out_of_range("Version field out of range.");
+        return (std::uint16_t)value;
+    }
+
+    // Arithmetic saturates at 0 and at the field maximum
+    static constexpr std::uint16_t clamped(long long value, int max)
+    {
+        return (std::uint16_t)(value < 0 ? 0 : (value > max ? max : value));
+    }
+
+    void assign_release(std::string_view release)
+    {
+        release_ = version_release_pool::instance().intern(release);
+        flags_ |= release_flag;
+    }
+
+    // Number of numeric fields that were set, 2 to 4, or 5 for versions constructed with
+    // every field and a release tag
+    constexpr int seq_field_count() const { return flags_ & 0x07; }
+    constexpr bool release_set() const { return (flags_ & release_flag) != 0; }
+
+    // Narrow fields, the flags and the release handle keep the version trivially copyable
+    // in 16 bytes, so arrays of versions can be copied with memcpy. Release handles are
+    // only meaningful within the process that interned them. The numeric fields are laid
+    // out from least to most significant so they read as one 64-bit word, see key.
+    std::uint16_t build_ = 0;
+    std::uint16_t revision_ = 0;
+    std::uint16_t minor_ = 0;
+    std::uint16_t major_ = 0;
+    std::uint32_t release_ = 0;
+    std::uint8_t flags_ = 2;
 };
 
+// Compile time version, "2.4.1-rc1"_ver, see version::parse_constant
+constexpr version operator""_ver(const char* str, std::size_t length)
+{
+    return version::parse_constant(std::string_view(str, length));
+}
+
+namespace std
+{
+    template <>
+    struct hash<version>
+    {
+        std::size_t operator()(const version& v) const noexcept
+        {
+            return v.hash();
+        }
+    };
+}
+
 #endif
\ No newline at end of file
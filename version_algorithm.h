@@ -0,0 +1,253 @@
+// sai - General purpose self-contained C++ libraries.
+//
+// version_algorithm.h
+// Bulk algorithms over large arrays of versions.
+// 
+// MIT License
+// 
+// Copyright (c) 2017 Ion Todirel
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef SAI_CORE_VERSION_ALGORITHM_H
+#define SAI_CORE_VERSION_ALGORITHM_H
+
+#include "version.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+#include <memory>
+#include <utility>
+
+// Result of format_versions. next is the first version that was not written, last on
+// success. On value_too_large [out_first, ptr) holds whole versions each followed by the
+// separator, so formatting [next, last) into a fresh buffer continues the same text.
+struct version_format_result
+{
+    const version* next;
+    char* ptr;
+    std::errc ec;
+};
+
+// Arrays at or below this size are finished with an insertion sort
+constexpr std::size_t version_sort_cutoff = 64;
+
+// Stable least significant digit radix sort of count version keys, one byte per pass.
+// Bytes shared by every key, like the high bytes of a catalog with a handful of major
+// versions, are skipped without moving data. When order is not null it is permuted
+// along with the keys.
+inline void radix_sort_version_keys(std::uint64_t* keys, std::size_t* order, std::size_t count)
+{
+    if (count <= version_sort_cutoff)
+    {
+        for (std::size_t i = 1; i < count; i++)
+        {
+            std::uint64_t key = keys[i];
+            std::size_t index = order != nullptr ? order[i] : 0;
+            std::size_t j = i;
+            for (; j > 0 && keys[j - 1] > key; j--)
+            {
+                keys[j] = keys[j - 1];
+                if (order != nullptr)
+                    order[j] = order[j - 1];
+            }
+            keys[j] = key;
+            if (order != nullptr)
+                order[j] = index;
+        }
+        return;
+    }
+
+    std::vector<std::size_t> counts(8 * 256);
+    for (std::size_t i = 0; i < count; i++)
+    {
+        std::uint64_t key = keys[i];
+        for (unsigned digit = 0; digit < 8; digit++)
+            counts[digit * 256 + ((key >> (digit * 8)) & 0xFF)]++;
+    }
+
+    std::unique_ptr<std::uint64_t[]> key_scratch(new std::uint64_t[count]);
+    std::unique_ptr<std::size_t[]> order_scratch(order != nullptr ? new std::size_t[count] : nullptr);
+    std::uint64_t* from = keys;
+    std::uint64_t* to = key_scratch.get();
+    std::size_t* order_from = order;
+    std::size_t* order_to = order_scratch.get();
+    for (unsigned digit = 0; digit < 8; digit++)
+    {
+        std::size_t* digit_counts = counts.data() + digit * 256;
+        unsigned shift = digit * 8;
+        if (digit_counts[(from[0] >> shift) & 0xFF] == count)
+            continue;
+
+        std::size_t offsets[256];
+        std::size_t offset = 0;
+        for (unsigned b = 0; b < 256; b++)
+        {
+            offsets[b] = offset;
+            offset += digit_counts[b];
+        }
+        for (std::size_t i = 0; i < count; i++)
+        {
+            std::size_t position = offsets[(from[i] >> shift) & 0xFF]++;
+            to[position] = from[i];
+            if (order != nullptr)
+                order_to[position] = order_from[i];
+        }
+        std::swap(from, to);
+        std::swap(order_from, order_to);
+    }
+
+    if (from != keys)
+    {
+        std::copy(from, from + count, keys);
+        if (order != nullptr)
+            std::copy(order_from, order_from + count, order);
+    }
+}
+
+// Sorts count packed version keys, see version::key
+inline void sort_versions(std::uint64_t* keys, std::size_t count)
+{
+    radix_sort_version_keys(keys, nullptr, count);
+}
+
+// Sorts count packed version keys, moving the release tags in the parallel releases
+// array along with them. Versions with equal keys keep their relative order.
+inline void sort_versions(std::uint64_t* keys, std::string* releases, std::size_t count)
+{
+    std::vector<std::size_t> order(count);
+    for (std::size_t i = 0; i < count; i++)
+        order[i] = i;
+    radix_sort_version_keys(keys, order.data(), count);
+
+    std::vector<std::string> sorted(count);
+    for (std::size_t i = 0; i < count; i++)
+        sorted[i] = std::move(releases[order[i]]);
+    std::move(sorted.begin(), sorted.end(), releases);
+}
+
+// Sorts count packed version keys, moving the release handles in the parallel releases
+// array along with them, see version::release_handle
+inline void sort_versions(std::uint64_t* keys, std::uint32_t* releases, std::size_t count)
+{
+    std::vector<std::size_t> order(count);
+    for (std::size_t i = 0; i < count; i++)
+        order[i] = i;
+    radix_sort_version_keys(keys, order.data(), count);
+
+    std::vector<std::uint32_t> sorted(count);
+    for (std::size_t i = 0; i < count; i++)
+        sorted[i] = releases[order[i]];
+    std::copy(sorted.begin(), sorted.end(), releases);
+}
+
+// Stable sort of [first, last) by key. Versions are small and trivially copyable, so
+// they are scattered directly on each radix pass instead of through a permutation.
+inline void sort_versions(version* first, version* last)
+{
+    std::size_t count = (std::size_t)(last - first);
+    if (count <= version_sort_cutoff)
+    {
+        std::stable_sort(first, last);
+        return;
+    }
+
+    std::vector<std::size_t> counts(8 * 256);
+    for (std::size_t i = 0; i < count; i++)
+    {
+        std::uint64_t key = first[i].key();
+        for (unsigned digit = 0; digit < 8; digit++)
+            counts[digit * 256 + ((key >> (digit * 8)) & 0xFF)]++;
+    }
+
+    std::unique_ptr<version[]> scratch(new version[count]);
+    version* from = first;
+    version* to = scratch.get();
+    for (unsigned digit = 0; digit < 8; digit++)
+    {
+        std::size_t* digit_counts = counts.data() + digit * 256;
+        unsigned shift = digit * 8;
+        if (digit_counts[(from[0].key() >> shift) & 0xFF] == count)
+            continue;
+
+        std::size_t offsets[256];
+        std::size_t offset = 0;
+        for (unsigned b = 0; b < 256; b++)
+        {
+            offsets[b] = offset;
+            offset += digit_counts[b];
+        }
+        for (std::size_t i = 0; i < count; i++)
+            to[offsets[(from[i].key() >> shift) & 0xFF]++] = from[i];
+        std::swap(from, to);
+    }
+
+    if (from != first)
+        std::copy(from, from + count, first);
+}
+
+// Writes [first, last) into [out_first, out_last) as version::to_chars does, with the
+// separator between versions, in a single pass and without allocating
+inline version_format_result format_versions(const version* first, const version* last, char* out_first, char* out_last, std::string_view separator = "\n")
+{
+    char* p = out_first;
+    // Start of the version before v, where to back up to when the separator after it does not fit
+    char* previous = out_first;
+    for (const version* v = first; v != last; v++)
+    {
+        if (v != first)
+        {
+            if ((std::size_t)(out_last - p) < separator.length())
+                return { v - 1, previous, std::errc::value_too_large };
+            std::memcpy(p, separator.data(), separator.length());
+            p += separator.length();
+        }
+        version_to_chars_result result = v->to_chars(p, out_last);
+        if (result.ec != std::errc())
+            return { v, p, result.ec };
+        previous = p;
+        p = result.ptr;
+    }
+    return { last, p, std::errc() };
+}
+
+// Formats [first, last) into a single string, see format_versions above
+inline std::string format_versions(const version* first, const version* last, std::string_view separator = "\n")
+{
+    std::string str((std::size_t)(last - first) * (12 + separator.length()) + 64, '\0');
+    std::size_t length = 0;
+    for (;;)
+    {
+        version_format_result result = format_versions(first, last, &str[0] + length, &str[0] + str.length(), separator);
+        length = (std::size_t)(result.ptr - str.data());
+        first = result.next;
+        if (result.ec == std::errc())
+            break;
+        str.resize(str.length() * 2);
+    }
+    str.resize(length);
+    return str;
+}
+
+#endif
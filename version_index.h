@@ -0,0 +1,265 @@
+// sai - General purpose self-contained C++ libraries.
+//
+// version_index.h
+// Sorted version index with predecessor, successor and range queries.
+// 
+// MIT License
+// 
+// Copyright (c) 2017 Ion Todirel
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef SAI_CORE_VERSION_INDEX_H
+#define SAI_CORE_VERSION_INDEX_H
+
+#include "version.h"
+#include "version_algorithm.h"
+#include "version_range.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <iterator>
+#include <utility>
+#include <algorithm>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Versions sorted by key and searched through an Eytzinger layout of their keys: the
+// implicit binary search tree is stored breadth first, so the first levels of every
+// search share cache lines and the next levels are prefetched while a node is compared.
+// The tree is padded to a perfect one, which makes every search the same number of
+// steps and lets the position of the answer be read off the path taken.
+// Built in bulk from an unsorted array and updated by merging in batches of versions.
+// Versions with equal keys, which only differ by release text, keep their insertion order.
+class version_index
+{
+public:
+    version_index() {}
+
+    version_index(const version* first, const version* last)
+    {
+        build(first, last);
+    }
+
+    // Replaces the index with the versions of [first, last)
+    void build(const version* first, const version* last)
+    {
+        versions_.assign(first, last);
+        sort_versions(versions_.data(), versions_.data() + versions_.size());
+        build_tree();
+    }
+
+    // Adds the versions of [first, last), merging them into the sorted versions in linear time
+    void insert(const version* first, const version* last)
+    {
+        std::vector<version> batch(first, last);
+        sort_versions(batch.data(), batch.data() + batch.size());
+        std::vector<version> merged;
+        merged.reserve(versions_.size() + batch.size());
+        std::merge(versions_.begin(), versions_.end(), batch.begin(), batch.end(), std::back_inserter(merged));
+        versions_.swap(merged);
+        build_tree();
+    }
+
+    void insert(const version& v)
+    {
+        insert(&v, &v + 1);
+    }
+
+    void clear()
+    {
+        versions_.clear();
+        build_tree();
+    }
+
+    std::size_t size() const { return versions_.size(); }
+    bool empty() const { return versions_.empty(); }
+
+    // Versions in ascending order
+    const version& operator[](std::size_t index) const { return versions_[index]; }
+    const version* begin() const { return versions_.data(); }
+    const version* end() const { return versions_.data() + versions_.size(); }
+
+    // Position of the first version whose key is not less than key
+    std::size_t lower_bound(std::uint64_t key) const
+    {
+        std::size_t k = 1;
+        for (unsigned level = 0; level < height_; level++)
+        {
+            // The 16 descendants four levels down fill the two cache lines starting at node
+            // 16k. The addresses may be past the end of the tree, which is harmless since
+            // prefetches never fault.
+            std::uintptr_t line = (std::uintptr_t)tree_.data() + k * 2 * sizeof(tree_line);
+            prefetch((const void*)line);
+            prefetch((const void*)(line + sizeof(tree_line)));
+            k = 2 * k + (node(k) < key ? 1 : 0);
+        }
+        // The turns taken, read as a binary number, count the keys less than key
+        std::size_t position = k - ((std::size_t)1 << height_);
+        return position < versions_.size() ? position : versions_.size();
+    }
+
+    // Position of the first version whose key is greater than key
+    std::size_t upper_bound(std::uint64_t key) const
+    {
+        return key == ~0ull ? versions_.size() : lower_bound(key + 1);
+    }
+
+    std::size_t lower_bound(const version& v) const { return lower_bound(v.key()); }
+    std::size_t upper_bound(const version& v) const { return upper_bound(v.key()); }
+
+    bool contains(const version& v) const
+    {
+        std::size_t i = lower_bound(v.key());
+        return i < versions_.size() && versions_[i] == v;
+    }
+
+    // Greatest version less than v, the last of equal ones, or nullptr if there is none
+    const version* predecessor(const version& v) const
+    {
+        std::size_t i = lower_bound(v.key());
+        return i == 0 ? nullptr : &versions_[i - 1];
+    }
+
+    // Smallest version greater than v, the first of equal ones, or nullptr if there is none
+    const version* successor(const version& v) const
+    {
+        std::size_t i = upper_bound(v.key());
+        return i == versions_.size() ? nullptr : &versions_[i];
+    }
+
+    // Versions from low to high inclusive, as a [first, last) span of the sorted versions
+    std::pair<const version*, const version*> range(const version& low, const version& high) const
+    {
+        std::size_t first = lower_bound(low.key());
+        std::size_t last = upper_bound(high.key());
+        return { begin() + first, begin() + (last > first ? last : first) };
+    }
+
+    // Versions with the given major, as a [first, last) span of the sorted versions
+    std::pair<const version*, const version*> range(int major) const
+    {
+        if (major < 0 || major > version::max_major)
+            return { end(), end() };
+        std::size_t first = lower_bound(version::pack(major, 0, 0, 0, false));
+        std::size_t last = major == version::max_major ? versions_.size() : lower_bound(version::pack(major + 1, 0, 0, 0, false));
+        return { begin() + first, begin() + last };
+    }
+
+    // Greatest version with the given major, or nullptr if there is none
+    const version* latest(int major) const
+    {
+        std::pair<const version*, const version*> span = range(major);
+        return span.first == span.second ? nullptr : span.second - 1;
+    }
+
+    // Greatest version of each major, in ascending order, found with one search per major
+    std::vector<version> latest_per_major() const
+    {
+        std::vector<version> latest;
+        std::size_t last = versions_.size();
+        while (last > 0)
+        {
+            const version& v = versions_[last - 1];
+            latest.push_back(v);
+            last = lower_bound(version::pack(v.major(), 0, 0, 0, false));
+        }
+        std::reverse(latest.begin(), latest.end());
+        return latest;
+    }
+
+    // Greatest version in the range, the last of equal ones, or nullptr if there is none,
+    // found with one search per interval of the range from the highest down
+    const version* max_satisfying(const version_range& range) const
+    {
+        const std::vector<version_interval>& intervals = range.intervals();
+        for (std::size_t i = intervals.size(); i > 0; i--)
+        {
+            std::size_t last = upper_bound(intervals[i - 1].high);
+            if (last > 0 && versions_[last - 1].key() >= intervals[i - 1].low)
+                return &versions_[last - 1];
+        }
+        return nullptr;
+    }
+
+    // Smallest version in the range, the first of equal ones, or nullptr if there is none
+    const version* min_satisfying(const version_range& range) const
+    {
+        for (const version_interval& interval : range.intervals())
+        {
+            std::size_t first = lower_bound(interval.low);
+            if (first < versions_.size() && versions_[first].key() <= interval.high)
+                return &versions_[first];
+        }
+        return nullptr;
+    }
+
+private:
+    // Eight nodes on one cache line, so node k lies on line k / 8
+    struct alignas(64) tree_line
+    {
+        std::uint64_t keys[8];
+    };
+
+    std::uint64_t node(std::size_t k) const { return tree_[k / 8].keys[k % 8]; }
+    std::uint64_t& node(std::size_t k) { return tree_[k / 8].keys[k % 8]; }
+
+    static void prefetch(const void* address)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        __builtin_prefetch(address);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+        _mm_prefetch((const char*)address, _MM_HINT_T0);
+#else
+        (void)address;
+#endif
+    }
+
+    // Lays the sorted keys out breadth first in a perfect tree of height_ levels, tree_[1]
+    // is the root and the children of node k are 2k and 2k + 1. Node k at depth d holds
+    // the key at position (2 * (k - 2^d) + 1) * 2^(height_ - 1 - d) - 1, positions past
+    // the end hold the largest key so they sort after every version.
+    void build_tree()
+    {
+        std::size_t n = versions_.size();
+        height_ = 0;
+        while ((((std::size_t)1 << height_) - 1) < n)
+            height_++;
+        tree_line padding;
+        std::fill(padding.keys, padding.keys + 8, ~0ull);
+        tree_.assign((((std::size_t)1 << height_) + 7) / 8, padding);
+        for (unsigned depth = 0; depth < height_; depth++)
+        {
+            std::size_t first = (std::size_t)1 << depth;
+            std::size_t step = (std::size_t)1 << (height_ - depth);
+            std::size_t position = step / 2 - 1;
+            for (std::size_t k = first; k < 2 * first && position < n; k++, position += step)
+                node(k) = versions_[position].key();
+        }
+    }
+
+    std::vector<version> versions_;
+    std::vector<tree_line> tree_ = std::vector<tree_line>(1);
+    unsigned height_ = 0;
+};
+
+#endif
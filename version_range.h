@@ -0,0 +1,480 @@
+// sai - General purpose self-contained C++ libraries.
+//
+// version_range.h
+// Version constraint expressions compiled into key intervals.
+// 
+// MIT License
+// 
+// Copyright (c) 2017 Ion Todirel
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef SAI_CORE_VERSION_RANGE_H
+#define SAI_CORE_VERSION_RANGE_H
+
+#include "version.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+
+#if !defined(SAI_CORE_NO_SIMD) && defined(__AVX2__)
+#define SAI_CORE_VERSION_RANGE_AVX2
+#include <immintrin.h>
+#endif
+
+// Inclusive interval of version keys, see version::key
+struct version_interval
+{
+    std::uint64_t low;
+    std::uint64_t high;
+};
+
+// Set of versions described by an expression like ">=1.2.0 <2.0.0 || ~3.4".
+// Comparators separated by spaces must all hold, alternatives are separated by ||.
+// The supported comparators are =, >, >=, <, <=, ~ (same major and minor, or same
+// major if only the major is given), ^ (same first non-zero field) and bare
+// versions, which match exactly. *, x and X match anything and a trailing .x or .*
+// matches any value of the remaining fields. Versions compare by key, so as with
+// version itself 1.2 equals 1.2.0 and a release tag sorts after the plain version.
+// The expression is compiled once into sorted, disjoint key intervals.
+class version_range
+{
+public:
+    static version_range parse(std::string_view expression)
+    {
+        version_range range;
+        std::size_t position = 0;
+        if (!compile(expression, range.intervals_, position))
+            throw version_parse_exception("Could not parse version range, unexpected character at position " + std::to_string(position) + ".", position);
+        return range;
+    }
+
+    static bool try_parse(std::string_view expression, version_range& result) noexcept
+    {
+        std::vector<version_interval> intervals;
+        std::size_t position = 0;
+        if (!compile(expression, intervals, position))
+            return false;
+        result.intervals_.swap(intervals);
+        return true;
+    }
+
+    // An empty range, it matches no version
+    version_range() {}
+    explicit version_range(std::string_view expression) { *this = parse(expression); }
+
+    const std::vector<version_interval>& intervals() const { return intervals_; }
+
+    bool empty() const { return intervals_.empty(); }
+
+    bool contains(const version& v) const
+    {
+        return contains(v.key());
+    }
+
+    bool contains(std::uint64_t key) const
+    {
+        for (const version_interval& interval : intervals_)
+        {
+            if (key <= interval.high)
+                return key >= interval.low;
+        }
+        return false;
+    }
+
+    // Writes whether each of the count keys is in the range to result
+    void contains(const std::uint64_t* keys, std::size_t count, bool* result) const
+    {
+        std::size_t i = 0;
+#ifdef SAI_CORE_VERSION_RANGE_AVX2
+        for (; i + 4 <= count; i += 4)
+        {
+            int mask = match4(_mm256_loadu_si256((const __m256i*)(keys + i)));
+            result[i] = (mask & 1) != 0;
+            result[i + 1] = (mask & 2) != 0;
+            result[i + 2] = (mask & 4) != 0;
+            result[i + 3] = (mask & 8) != 0;
+        }
+#endif
+        for (; i < count; i++)
+            result[i] = matches(keys[i]);
+    }
+
+    // Number of the count keys in the range
+    std::size_t count(const std::uint64_t* keys, std::size_t count) const
+    {
+        std::size_t matches = 0;
+        std::size_t i = 0;
+#ifdef SAI_CORE_VERSION_RANGE_AVX2
+        for (; i + 4 <= count; i += 4)
+            matches += (std::size_t)popcount4(match4(_mm256_loadu_si256((const __m256i*)(keys + i))));
+#endif
+        for (; i < count; i++)
+            matches += this->matches(keys[i]) ? 1 : 0;
+        return matches;
+    }
+
+    // Greatest key of [first, last) in the range, last if there is none
+    const std::uint64_t* max_satisfying(const std::uint64_t* first, const std::uint64_t* last) const
+    {
+        return best_satisfying(first, last, true);
+    }
+
+    // Smallest key of [first, last) in the range, last if there is none
+    const std::uint64_t* min_satisfying(const std::uint64_t* first, const std::uint64_t* last) const
+    {
+        return best_satisfying(first, last, false);
+    }
+
+    // Greatest version of [first, last) in the range, the first of equal ones, last if there is none
+    const version* max_satisfying(const version* first, const version* last) const
+    {
+        const version* best = last;
+        std::uint64_t best_key = 0;
+        for (const version* v = first; v != last; v++)
+        {
+            std::uint64_t key = v->key();
+            if ((best == last || key > best_key) && contains(key))
+            {
+                best = v;
+                best_key = key;
+            }
+        }
+        return best;
+    }
+
+    // Smallest version of [first, last) in the range, the first of equal ones, last if there is none
+    const version* min_satisfying(const version* first, const version* last) const
+    {
+        const version* best = last;
+        std::uint64_t best_key = 0;
+        for (const version* v = first; v != last; v++)
+        {
+            std::uint64_t key = v->key();
+            if ((best == last || key < best_key) && contains(key))
+            {
+                best = v;
+                best_key = key;
+            }
+        }
+        return best;
+    }
+
+private:
+    static constexpr std::uint64_t max_key = ~0ull;
+
+    // Branch free form of contains for the batch loops, a key is in an interval when
+    // its offset from the low end is within the width of the interval
+    bool matches(std::uint64_t key) const
+    {
+        bool matched = false;
+        for (const version_interval& interval : intervals_)
+            matched |= key - interval.low <= interval.high - interval.low;
+        return matched;
+    }
+
+    static bool is_space(char ch)
+    {
+        return ch == ' ' || ch == '\t';
+    }
+
+    static bool is_wildcard(char ch)
+    {
+        return ch == '*' || ch == 'x' || ch == 'X';
+    }
+
+    // Key just past every version that starts with the first count fields of numbers,
+    // max_key + 1 wraps to 0 when there is no such version
+    static std::uint64_t next_key(const int* numbers, int count)
+    {
+        int next[4] = { numbers[0], numbers[1], numbers[2], numbers[3] };
+        for (int i = count; i < 4; i++)
+            next[i] = 0;
+        for (int i = count - 1; i >= 0; i--)
+        {
+            if (next[i] < (i == 0 ? version::max_major : version::max_field))
+            {
+                next[i]++;
+                return version::pack(next[0], next[1], next[2], next[3], false);
+            }
+            next[i] = 0;
+        }
+        return 0;
+    }
+
+    // Parses one comparator starting at text[position], intersecting low and high with it
+    static bool compile_comparator(std::string_view text, std::size_t& position, std::uint64_t& low, std::uint64_t& high)
+    {
+        char op[2] = {};
+        if (text[position] == '>' || text[position] == '<')
+        {
+            op[0] = text[position++];
+            if (position < text.length() && text[position] == '=')
+                op[1] = text[position++];
+        }
+        else if (text[position] == '=' || text[position] == '~' || text[position] == '^')
+        {
+            op[0] = text[position++];
+        }
+        while (position < text.length() && is_space(text[position]))
+            position++;
+
+        std::size_t start = position;
+        while (position < text.length() && !is_space(text[position]) && text[position] != '|')
+            position++;
+        std::string_view token = text.substr(start, position - start);
+        if (token.empty())
+            return false;
+
+        // Numeric prefix up to a wildcard, then an exact version for the rest
+        int numbers[4] = {};
+        int count = 0;
+        bool wildcard = false;
+        std::uint64_t exact = 0;
+        if (token.length() == 1 && is_wildcard(token[0]))
+        {
+            wildcard = true;
+        }
+        else
+        {
+            std::size_t dot = token.length();
+            if (token.length() >= 2 && is_wildcard(token.back()) && token[token.length() - 2] == '.')
+            {
+                wildcard = true;
+                dot = token.length() - 2;
+            }
+            version v;
+            version_from_chars_result parsed = version::from_chars(token.data(), token.data() + dot, v);
+            if (parsed.ec != std::errc())
+            {
+                position = start + (std::size_t)(parsed.ptr - token.data());
+                return false;
+            }
+            if (wildcard && v.release().length() > 0)
+            {
+                position = start + dot;
+                return false;
+            }
+            numbers[0] = v.major();
+            numbers[1] = v.minor();
+            numbers[2] = v.revision();
+            numbers[3] = v.build();
+            count = 1;
+            for (std::size_t i = 0; i < dot && token[i] != '-'; i++)
+                count += token[i] == '.' ? 1 : 0;
+            if (wildcard && count == 4)
+            {
+                position = start + dot;
+                return false;
+            }
+            exact = v.key();
+        }
+
+        // Versions matching the token itself, an x-range or a single key
+        std::uint64_t first = wildcard ? version::pack(numbers[0], numbers[1], numbers[2], numbers[3], false) : exact;
+        std::uint64_t last = wildcard ? (count == 0 ? max_key : next_key(numbers, count) - 1) : exact;
+
+        std::uint64_t from = 0;
+        std::uint64_t to = max_key;
+        if (op[0] == '>' && op[1] == '=')
+        {
+            from = first;
+        }
+        else if (op[0] == '>')
+        {
+            if (last == max_key)
+                from = max_key, to = 0;
+            else
+                from = last + 1;
+        }
+        else if (op[0] == '<' && op[1] == '=')
+        {
+            to = last;
+        }
+        else if (op[0] == '<')
+        {
+            if (first == 0)
+                from = max_key, to = 0;
+            else
+                to = first - 1;
+        }
+        else if ((op[0] == '~' || op[0] == '^') && count > 0)
+        {
+            // ~ allows changes below the minor field, or below the major field if only
+            // the major is given. ^ allows changes below the first non-zero field, or
+            // below the last given field if they are all zero.
+            int fixed = 1;
+            if (op[0] == '~')
+            {
+                fixed = count == 1 ? 1 : 2;
+            }
+            else
+            {
+                fixed = count;
+                for (int i = 0; i < count; i++)
+                {
+                    if (numbers[i] != 0)
+                    {
+                        fixed = i + 1;
+                        break;
+                    }
+                }
+            }
+            from = wildcard ? first : exact;
+            to = next_key(numbers, fixed) - 1;
+        }
+        else
+        {
+            from = first;
+            to = last;
+        }
+
+        low = from > low ? from : low;
+        high = to < high ? to : high;
+        return true;
+    }
+
+    // Compiles the expression into sorted disjoint intervals, on failure position is
+    // the offset of the first offending character
+    static bool compile(std::string_view text, std::vector<version_interval>& intervals, std::size_t& position)
+    {
+        intervals.clear();
+        position = 0;
+        for (;;)
+        {
+            std::uint64_t low = 0;
+            std::uint64_t high = max_key;
+            for (;;)
+            {
+                while (position < text.length() && is_space(text[position]))
+                    position++;
+                if (position == text.length() || text[position] == '|')
+                    break;
+                if (!compile_comparator(text, position, low, high))
+                    return false;
+            }
+            // an empty alternative, like an empty expression, matches anything
+            if (low <= high)
+                intervals.push_back({ low, high });
+
+            if (position == text.length())
+                break;
+            if (position + 1 == text.length() || text[position + 1] != '|')
+                return false;
+            position += 2;
+        }
+
+        std::sort(intervals.begin(), intervals.end(), [](const version_interval& a, const version_interval& b) { return a.low < b.low; });
+        std::size_t merged = 0;
+        for (std::size_t i = 0; i < intervals.size(); i++)
+        {
+            if (merged > 0 && (intervals[merged - 1].high == max_key || intervals[i].low <= intervals[merged - 1].high + 1))
+            {
+                if (intervals[i].high > intervals[merged - 1].high)
+                    intervals[merged - 1].high = intervals[i].high;
+            }
+            else
+            {
+                intervals[merged++] = intervals[i];
+            }
+        }
+        intervals.resize(merged);
+        return true;
+    }
+
+    const std::uint64_t* best_satisfying(const std::uint64_t* first, const std::uint64_t* last, bool greatest) const
+    {
+        std::size_t count = (std::size_t)(last - first);
+        bool found = false;
+        std::uint64_t best = 0;
+        std::size_t i = 0;
+#ifdef SAI_CORE_VERSION_RANGE_AVX2
+        // Keys are compared as signed after flipping the top bit, unmatched lanes hold
+        // the identity of the reduction
+        const __m256i bias = _mm256_set1_epi64x((long long)0x8000000000000000ull);
+        const __m256i identity = greatest ? _mm256_set1_epi64x((long long)0x8000000000000000ull) : _mm256_set1_epi64x(0x7FFFFFFFFFFFFFFFll);
+        __m256i best_lanes = identity;
+        __m256i any = _mm256_setzero_si256();
+        for (; i + 4 <= count; i += 4)
+        {
+            __m256i keys = _mm256_loadu_si256((const __m256i*)(first + i));
+            __m256i matched = match4_lanes(keys);
+            __m256i candidates = _mm256_blendv_epi8(identity, _mm256_xor_si256(keys, bias), matched);
+            __m256i better = greatest ? _mm256_cmpgt_epi64(candidates, best_lanes) : _mm256_cmpgt_epi64(best_lanes, candidates);
+            best_lanes = _mm256_blendv_epi8(best_lanes, candidates, better);
+            any = _mm256_or_si256(any, matched);
+        }
+        int any_mask = _mm256_movemask_pd(_mm256_castsi256_pd(any));
+        alignas(32) std::uint64_t lanes[4];
+        _mm256_store_si256((__m256i*)lanes, _mm256_xor_si256(best_lanes, bias));
+        for (int lane = 0; lane < 4; lane++)
+        {
+            if ((any_mask & (1 << lane)) != 0 && (!found || (greatest ? lanes[lane] > best : lanes[lane] < best)))
+            {
+                best = lanes[lane];
+                found = true;
+            }
+        }
+#endif
+        for (; i < count; i++)
+        {
+            std::uint64_t key = first[i];
+            if ((!found || (greatest ? key > best : key < best)) && contains(key))
+            {
+                best = key;
+                found = true;
+            }
+        }
+        return found ? std::find(first, last, best) : last;
+    }
+
+#ifdef SAI_CORE_VERSION_RANGE_AVX2
+    // All ones in each lane whose key is in the range
+    __m256i match4_lanes(__m256i keys) const
+    {
+        const __m256i bias = _mm256_set1_epi64x((long long)0x8000000000000000ull);
+        __m256i outside = _mm256_set1_epi64x(-1);
+        for (const version_interval& interval : intervals_)
+        {
+            __m256i offset = _mm256_xor_si256(_mm256_sub_epi64(keys, _mm256_set1_epi64x((long long)interval.low)), bias);
+            __m256i width = _mm256_set1_epi64x((long long)((interval.high - interval.low) ^ 0x8000000000000000ull));
+            outside = _mm256_and_si256(outside, _mm256_cmpgt_epi64(offset, width));
+        }
+        return _mm256_xor_si256(outside, _mm256_set1_epi64x(-1));
+    }
+
+    int match4(__m256i keys) const
+    {
+        return _mm256_movemask_pd(_mm256_castsi256_pd(match4_lanes(keys)));
+    }
+
+    static int popcount4(int mask)
+    {
+        return (mask & 1) + ((mask >> 1) & 1) + ((mask >> 2) & 1) + ((mask >> 3) & 1);
+    }
+#endif
+
+    std::vector<version_interval> intervals_;
+};
+
+#endif
@@ -0,0 +1,262 @@
+// sai - General purpose self-contained C++ libraries.
+//
+// version_table.h
+// Column storage of named versions loaded from manifest files.
+// 
+// MIT License
+// 
+// Copyright (c) 2017 Ion Todirel
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef SAI_CORE_VERSION_TABLE_H
+#define SAI_CORE_VERSION_TABLE_H
+
+#include "version.h"
+#include "mapped_file.h"
+#include "parallel_run.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+
+struct version_parse_error
+{
+    // Zero based index of the malformed line
+    std::size_t line = 0;
+    // Offset of the first offending character in the parsed text
+    std::size_t offset = 0;
+};
+
+// Inputs smaller than this are parsed on the calling thread
+constexpr std::size_t version_parse_chunk_size = 1 << 20;
+
+// Names and versions stored as a structure of arrays, one column per version field,
+// filled from manifests made of "name version" lines
+class version_table
+{
+public:
+    version_table() {}
+
+    // Maps the manifest at path and parses it, see parse. Throws std::system_error if the
+    // file cannot be read.
+    bool load(const std::string& path, std::vector<version_parse_error>& errors, unsigned thread_count = 0)
+    {
+        mapped_file file(path, mapped_file_access::sequential);
+        return parse(file.view(), errors, thread_count);
+    }
+
+    // Replaces the table with the lines of text, each a name and a version separated by
+    // spaces or tabs. Lines may be indented and end with \r, blank lines are skipped.
+    // Malformed lines are left out of the table and reported in errors, in line order.
+    // The text is split across thread_count threads, or one per core if thread_count
+    // is 0. Returns true if no line was malformed.
+    bool parse(std::string_view text, std::vector<version_parse_error>& errors, unsigned thread_count = 0)
+    {
+        clear();
+        errors.clear();
+
+        thread_count = parallel_thread_count(thread_count);
+        std::size_t max_chunks = text.size() / version_parse_chunk_size + 1;
+        std::size_t chunk_count = thread_count < max_chunks ? thread_count : max_chunks;
+
+        // Chunk boundaries are moved past the next newline so no line is split
+        std::vector<std::size_t> bounds(chunk_count + 1, text.size());
+        bounds[0] = 0;
+        for (std::size_t i = 1; i < chunk_count; i++)
+        {
+            std::size_t bound = text.size() / chunk_count * i;
+            if (bound < bounds[i - 1])
+                bound = bounds[i - 1];
+            std::size_t next = text.find('\n', bound);
+            bounds[i] = next == std::string_view::npos ? text.size() : next + 1;
+        }
+
+        std::vector<version_table> chunks(chunk_count);
+        std::vector<std::vector<version_parse_error>> chunk_errors(chunk_count);
+        std::vector<std::size_t> lines(chunk_count + 1, 0);
+        parallel_run(chunk_count, [&](std::size_t i) { lines[i + 1] = chunks[i].parse_lines(text.data() + bounds[i], text.data() + bounds[i + 1], bounds[i], chunk_errors[i]); });
+
+        // Chunks are stitched together in parallel at their final positions
+        std::vector<std::size_t> rows(chunk_count + 1, 0);
+        std::vector<std::size_t> name_bytes(chunk_count + 1, 0);
+        for (std::size_t i = 0; i < chunk_count; i++)
+        {
+            lines[i + 1] += lines[i];
+            rows[i + 1] = rows[i] + chunks[i].size();
+            name_bytes[i + 1] = name_bytes[i] + chunks[i].names_.size();
+            for (version_parse_error& error : chunk_errors[i])
+                error.line += lines[i];
+            errors.insert(errors.end(), chunk_errors[i].begin(), chunk_errors[i].end());
+        }
+
+        std::size_t count = rows[chunk_count];
+        majors_.resize(count);
+        minors_.resize(count);
+        revisions_.resize(count);
+        builds_.resize(count);
+        fields_.resize(count);
+        releases_.resize(count);
+        name_ends_.resize(count);
+        names_.resize(name_bytes[chunk_count]);
+        parallel_run(chunk_count, [&](std::size_t i)
+        {
+            const version_table& chunk = chunks[i];
+            std::size_t row = rows[i];
+            std::copy(chunk.majors_.begin(), chunk.majors_.end(), majors_.begin() + row);
+            std::copy(chunk.minors_.begin(), chunk.minors_.end(), minors_.begin() + row);
+            std::copy(chunk.revisions_.begin(), chunk.revisions_.end(), revisions_.begin() + row);
+            std::copy(chunk.builds_.begin(), chunk.builds_.end(), builds_.begin() + row);
+            std::copy(chunk.fields_.begin(), chunk.fields_.end(), fields_.begin() + row);
+            std::copy(chunk.releases_.begin(), chunk.releases_.end(), releases_.begin() + row);
+            for (std::size_t j = 0; j < chunk.size(); j++)
+                name_ends_[row + j] = chunk.name_ends_[j] + name_bytes[i];
+            std::copy(chunk.names_.begin(), chunk.names_.end(), names_.begin() + name_bytes[i]);
+        });
+
+        return errors.empty();
+    }
+
+    void clear()
+    {
+        majors_.clear();
+        minors_.clear();
+        revisions_.clear();
+        builds_.clear();
+        fields_.clear();
+        releases_.clear();
+        name_ends_.clear();
+        names_.clear();
+    }
+
+    std::size_t size() const { return majors_.size(); }
+    bool empty() const { return majors_.empty(); }
+
+    std::string_view name(std::size_t index) const
+    {
+        std::size_t begin = index == 0 ? 0 : name_ends_[index - 1];
+        return std::string_view(names_.data() + begin, name_ends_[index] - begin);
+    }
+
+    version operator[](std::size_t index) const
+    {
+        return version(majors_[index], minors_[index], revisions_[index], builds_[index], fields_[index], releases_[index]);
+    }
+
+    // Same as operator[](index).key() without building the version
+    std::uint64_t key(std::size_t index) const
+    {
+        return version::pack(majors_[index], minors_[index], revisions_[index], builds_[index], releases_[index] != version::no_release);
+    }
+
+    const std::vector<std::uint16_t>& majors() const { return majors_; }
+    const std::vector<std::uint16_t>& minors() const { return minors_; }
+    const std::vector<std::uint16_t>& revisions() const { return revisions_; }
+    const std::vector<std::uint16_t>& builds() const { return builds_; }
+    // Release handles in version_release_pool, or version::no_release
+    const std::vector<std::uint32_t>& releases() const { return releases_; }
+
+private:
+    static bool is_space(char ch)
+    {
+        return ch == ' ' || ch == '\t';
+    }
+
+    // Appends the lines of [first, last) to the table, base_offset is the offset of first
+    // in the whole text. Returns the number of lines, error lines are relative to first.
+    std::size_t parse_lines(const char* first, const char* last, std::size_t base_offset, std::vector<version_parse_error>& errors)
+    {
+        // Reserving for lines of about 24 characters avoids most reallocations
+        std::size_t estimate = (std::size_t)(last - first) / 24 + 1;
+        majors_.reserve(estimate);
+        minors_.reserve(estimate);
+        revisions_.reserve(estimate);
+        builds_.reserve(estimate);
+        fields_.reserve(estimate);
+        releases_.reserve(estimate);
+        name_ends_.reserve(estimate);
+        names_.reserve((std::size_t)(last - first) / 2);
+
+        std::size_t line = 0;
+        const char* p = first;
+        while (p < last)
+        {
+            const char* line_end = (const char*)std::memchr(p, '\n', (std::size_t)(last - p));
+            if (line_end == nullptr)
+                line_end = last;
+
+            const char* begin = p;
+            const char* end = line_end;
+            while (begin < end && is_space(*begin))
+                begin++;
+            while (end > begin && (is_space(end[-1]) || end[-1] == '\r'))
+                end--;
+
+            if (begin < end)
+            {
+                const char* name_end = begin;
+                while (name_end < end && !is_space(*name_end))
+                    name_end++;
+                const char* version_begin = name_end;
+                while (version_begin < end && is_space(*version_begin))
+                    version_begin++;
+
+                version v;
+                version_from_chars_result result = version::from_chars(version_begin, end, v);
+                if (result.ec == std::errc())
+                {
+                    majors_.push_back((std::uint16_t)v.major());
+                    minors_.push_back((std::uint16_t)v.minor());
+                    revisions_.push_back((std::uint16_t)v.revision());
+                    builds_.push_back((std::uint16_t)v.build());
+                    std::uint32_t release = v.release_handle();
+                    fields_.push_back((std::uint8_t)(v.fields() - (release != version::no_release ? 1 : 0)));
+                    releases_.push_back(release);
+                    names_.append(begin, name_end);
+                    name_ends_.push_back(names_.size());
+                }
+                else
+                {
+                    errors.push_back({ line, base_offset + (std::size_t)(result.ptr - first) });
+                }
+            }
+
+            line++;
+            p = line_end + 1;
+        }
+        return line;
+    }
+
+    std::vector<std::uint16_t> majors_;
+    std::vector<std::uint16_t> minors_;
+    std::vector<std::uint16_t> revisions_;
+    std::vector<std::uint16_t> builds_;
+    // Number of numeric fields of each version
+    std::vector<std::uint8_t> fields_;
+    std::vector<std::uint32_t> releases_;
+    // End offset of each name in names_
+    std::vector<std::size_t> name_ends_;
+    std::string names_;
+};
+
+#endif